@@ -0,0 +1,207 @@
+#include "qslib.hh"
+#include "allowexec.hh"
+
+// Usage: ./appendbench [-i REPEATS] [SIZE]
+//    Time each `ints_append` variant on containers of SIZE integers
+//    (default 100000), averaged over REPEATS calls (default 100), and count
+//    the heap allocations each call makes. The program replaces the global
+//    `operator new` to count allocations; the zero-allocation variants
+//    (splices, and appends into a buffer with enough capacity) are checked
+//    with `assert`.
+
+static size_t nallocs = 0;
+
+__attribute__((noinline)) void* operator new(size_t sz) {
+    ++nallocs;
+    if (void* p = malloc(sz ? sz : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+
+static std::vector<int> make_vector(int n, int first) {
+    std::vector<int> v(n);
+    for (int i = 0; i < n; ++i) {
+        v[i] = first + i;
+    }
+    return v;
+}
+
+template <typename L>
+static L make_list(int n, int first) {
+    L l;
+    for (int i = 0; i < n; ++i) {
+        l.push_back(first + i);
+    }
+    return l;
+}
+
+// Run `setup()` and then `op(state)` `repeats` times, timing and counting
+// allocations only in `op`, then verify each result with
+// `check(state, result)`. Checks that each call allocated exactly
+// `expected_allocs` times, if that is nonnegative.
+template <typename S, typename O, typename C>
+static void bench(const char* name, unsigned repeats, long expected_allocs,
+                  S setup, O op, C check) {
+    double elapsed = 0;
+    size_t allocs = 0;
+    for (unsigned r = 0; r != repeats; ++r) {
+        auto state = setup();
+        size_t a0 = nallocs;
+        double start = tstamp();
+        auto result = op(state);
+        elapsed += tstamp() - start;
+        size_t a = nallocs - a0;
+        allocs += a;
+        assert(expected_allocs < 0 || a == (size_t) expected_allocs);
+        assert(check(state, result));
+    }
+    printf("%-42s %12.3f %12.1f\n", name, elapsed / repeats * 1e6,
+           allocs / (double) repeats);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    int n = 100000;
+    unsigned repeats = 100;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc
+            && strisnumber(argv[i + 1]) && atoi(argv[i + 1]) > 0) {
+            repeats = strtoul(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strisnumber(argv[i]) && strtol(argv[i], NULL, 0) > 0) {
+            n = strtol(argv[i], NULL, 0);
+        } else {
+            fprintf(stderr, "Usage: %s [-i REPEATS] [SIZE]\n", argv[0]);
+            exit(1);
+        }
+    }
+    unsigned sum2 = ints_checksum(make_vector(2 * n, 0));
+    unsigned sum3 = ints_checksum(make_vector(3 * n, 0));
+
+    printf("%d integers per container\n", n);
+    printf("%-42s %12s %12s\n", "operation", "usec/call", "allocs/call");
+
+    using vpair = std::pair<std::vector<int>, std::vector<int>>;
+    auto vsetup = [=] {
+        return vpair(make_vector(n, 0), make_vector(n, n));
+    };
+    auto vcheck2 = [=] (vpair&, std::vector<int>& x) {
+        return ints_checksum(x) == sum2 && ints_sorted(x);
+    };
+    bench("vector ints_append(const&, const&)", repeats, 1, vsetup,
+          [] (vpair& s) { return ints_append(s.first, s.second); },
+          vcheck2);
+    bench("vector ints_append(&&, const&)", repeats, -1, vsetup,
+          [] (vpair& s) {
+              return ints_append(std::move(s.first), s.second);
+          },
+          vcheck2);
+    bench("vector ints_append(&&, const&) (reserved)", repeats, 0,
+          [=] {
+              vpair s = vsetup();
+              s.first.reserve(2 * n);
+              return s;
+          },
+          [] (vpair& s) {
+              return ints_append(std::move(s.first), s.second);
+          },
+          vcheck2);
+    bench("vector ints_append_into (reserved)", repeats, 0,
+          [=] {
+              vpair s = vsetup();
+              s.first.reserve(2 * n);
+              return s;
+          },
+          [] (vpair& s) {
+              ints_append_into(s.first, s.second);
+              return 0;
+          },
+          [=] (vpair& s, int) {
+              return ints_checksum(s.first) == sum2 && ints_sorted(s.first);
+          });
+
+    using vtriple = std::vector<std::vector<int>>;
+    auto v3setup = [=] {
+        return vtriple{make_vector(n, 0), make_vector(n, n),
+                       make_vector(n, 2 * n)};
+    };
+    auto vcheck3 = [=] (vtriple&, std::vector<int>& x) {
+        return ints_checksum(x) == sum3 && ints_sorted(x);
+    };
+    bench("vector chained ints_append x2", repeats, -1, v3setup,
+          [] (vtriple& s) {
+              return ints_append(ints_append(s[0], s[1]), s[2]);
+          },
+          vcheck3);
+    bench("vector ints_concat(a, b, c)", repeats, 1, v3setup,
+          [] (vtriple& s) { return ints_concat(s[0], s[1], s[2]); },
+          vcheck3);
+
+    using lpair = std::pair<std::list<int>, std::list<int>>;
+    auto lsetup = [=] {
+        return lpair(make_list<std::list<int>>(n, 0),
+                     make_list<std::list<int>>(n, n));
+    };
+    auto lcheck2 = [=] (lpair&, std::list<int>& x) {
+        return ints_checksum(x) == sum2 && ints_sorted(x);
+    };
+    bench("list ints_append(const&, const&)", repeats, 2 * n, lsetup,
+          [] (lpair& s) { return ints_append(s.first, s.second); },
+          lcheck2);
+    bench("list ints_append(&&, &&)", repeats, 0, lsetup,
+          [] (lpair& s) {
+              return ints_append(std::move(s.first), std::move(s.second));
+          },
+          lcheck2);
+    bench("list ints_append_into(&, &&)", repeats, 0, lsetup,
+          [] (lpair& s) {
+              ints_append_into(s.first, std::move(s.second));
+              return 0;
+          },
+          [=] (lpair& s, int) {
+              return ints_checksum(s.first) == sum2 && s.second.empty();
+          });
+    using ltriple = std::vector<std::list<int>>;
+    bench("list ints_concat(&&, &&, &&)", repeats, 0,
+          [=] {
+              ltriple s;
+              for (int i = 0; i < 3; ++i) {
+                  s.push_back(make_list<std::list<int>>(n, i * n));
+              }
+              return s;
+          },
+          [] (ltriple& s) {
+              return ints_concat(std::move(s[0]), std::move(s[1]),
+                                 std::move(s[2]));
+          },
+          [=] (ltriple&, std::list<int>& x) {
+              return ints_checksum(x) == sum3 && ints_sorted(x);
+          });
+
+    using cpair = std::pair<chunked_list, chunked_list>;
+    auto csetup = [=] {
+        return cpair(make_list<chunked_list>(n, 0),
+                     make_list<chunked_list>(n, n));
+    };
+    auto ccheck2 = [=] (cpair&, chunked_list& x) {
+        return ints_checksum(x) == sum2 && ints_sorted(x);
+    };
+    bench("chunked_list ints_append(const&, const&)", repeats, -1, csetup,
+          [] (cpair& s) { return ints_append(s.first, s.second); },
+          ccheck2);
+    bench("chunked_list ints_append(&&, &&)", repeats, 0, csetup,
+          [] (cpair& s) {
+              return ints_append(std::move(s.first), std::move(s.second));
+          },
+          ccheck2);
+}
@@ -1,19 +1,661 @@
 #include "qslib.hh"
+#include "allowexec.hh"
+#include "perfcounters.hh"
+#include "jitsum.hh"
+#include "feistel.hh"
+#include <climits>
+#include <cinttypes>
+#include <immintrin.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// Sweep mode
+//
+// Usage: ./arrayaccess -S [-a ACCESSES] [-e] [-H MODE] [-N NODE]
+//                       [MINBYTES [MAXBYTES]]
+//    Run every sweep pattern on data arrays whose sizes grow geometrically
+//    (two steps per doubling) from MINBYTES (default 4 KiB) to MAXBYTES
+//    (default 512 MiB), and print a table of nanoseconds per access. Each
+//    measurement makes at least ACCESSES accesses (default 2^24), repeating
+//    whole passes over the array.
+//
+//    The independent patterns load `data[index[i]]` as the normal mode
+//    does, so the CPU can overlap many loads and the table shows
+//    throughput; their working set also includes the (sequentially read)
+//    index array. The `chase` pattern follows `i = next[i]` around a single
+//    random cycle: each load depends on the last, so it measures load
+//    latency, and its steps mark the cache capacities most clearly. `-e`
+//    adds the chase's LLC and dTLB misses per access (see perfcounters.hh).
+//
+//    `-H none|thp|hugetlb` and `-N NODE|interleave` choose the page size
+//    and NUMA placement of both arrays (see hugealloc.hh); with `-H`, a
+//    final column shows how much of the data array huge pages back.
+//    Comparing `-H none` with `-H thp` separates TLB misses from cache
+//    misses: the cache behavior is the same, but 2 MiB pages cover 512
+//    times as much memory per TLB entry. The normal mode accepts the same
+//    options and prints the backing of its arrays.
+
+struct sweep_pattern {
+    const char* name;
+    void (*initialize)(int* array, int n);
+    bool dependent;
+};
+
+static void initialize_line_stride(int* array, int n) {
+    initialize_strided(array, n, 16);   // one int per 64-byte cache line
+}
+
+static const sweep_pattern sweep_patterns[] = {
+    {"seq", initialize_up, false},
+    {"stride16", initialize_line_stride, false},
+    {"random", initialize_random, false},
+    {"chase", initialize_chase, true}
+};
+
+static double sweep_time(const sweep_pattern& p, int* index, const int* data,
+                         int n, unsigned long naccesses, perf_counters* pc) {
+    p.initialize(index, n);
+    unsigned long passes = std::max((naccesses + n - 1) / n, 1UL);
+    double start = tstamp();
+    if (p.dependent) {
+        if (pc) {
+            pc->start();
+        }
+        int i = 0;
+        for (unsigned long k = 0; k != passes * n; ++k) {
+            i = index[i];
+        }
+        if (pc) {
+            pc->stop();
+        }
+        assert(i == 0);         // a single cycle returns to its start
+    } else {
+        unsigned checksum = ints_checksum(index, n);
+        start = tstamp();
+        unsigned sum = 0;
+        for (unsigned long pass = 0; pass != passes; ++pass) {
+            for (int i = 0; i != n; ++i) {
+                sum += (unsigned) data[index[i]];
+            }
+        }
+        assert(sum == checksum * (unsigned) passes);
+    }
+    return (tstamp() - start) * 1e9 / (passes * n);
+}
+
+static int sweep(int argc, char* argv[]) {
+    unsigned long minbytes = 4096, maxbytes = 512UL << 20;
+    unsigned long naccesses = 1UL << 24;
+    int nsizes = 0;
+    perf_counters* pc = nullptr;
+    alloc_options alloc;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "-e") == 0) {
+            pc = pc ? pc : new perf_counters;
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc
+                   && parse_huge_mode(argv[i + 1], alloc)) {
+            ++i;
+        } else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc
+                   && parse_numa_mode(argv[i + 1], alloc)) {
+            ++i;
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc
+            && strisnumber(argv[i + 1])) {
+            naccesses = strtoul(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strisnumber(argv[i]) && nsizes < 2) {
+            (nsizes == 0 ? minbytes : maxbytes) = strtoul(argv[i], NULL, 0);
+            ++nsizes;
+        } else {
+            fprintf(stderr, "Usage: %s -S [-a ACCESSES] [-e] [-H MODE] [-N NODE] [MINBYTES [MAXBYTES]]\n", argv[0]);
+            exit(1);
+        }
+    }
+    minbytes = std::max(minbytes, 64UL);
+    maxbytes = std::min(maxbytes, (unsigned long) INT_MAX * sizeof(int));
+
+    printf("%12s", "bytes");
+    for (auto& p : sweep_patterns) {
+        printf(" %10s", p.name);
+    }
+    if (pc) {
+        printf(" %10s %10s", "chase-LLC", "chase-dTLB");
+    }
+    if (alloc.huge != huge_none) {
+        printf(" %6s", "huge%");
+    }
+    printf("   (ns/access%s)\n", pc ? "; misses/access" : "");
+
+    for (unsigned long base = minbytes; base <= maxbytes; base *= 2) {
+        for (unsigned long bytes : {base, base + base / 2}) {
+            if (bytes > maxbytes) {
+                break;
+            }
+            int n = bytes / sizeof(int);
+            big_array index_mem = big_alloc(n * sizeof(int), alloc);
+            big_array data_mem = big_alloc(n * sizeof(int), alloc);
+            int* index = (int*) index_mem.ptr;
+            int* data = (int*) data_mem.ptr;
+            initialize_up(data, n);
+            printf("%12lu", bytes);
+            unsigned long nchase = 0;
+            for (auto& p : sweep_patterns) {
+                printf(" %10.3f", sweep_time(p, index, data, n, naccesses,
+                                             p.dependent ? pc : nullptr));
+                fflush(stdout);
+                if (p.dependent) {
+                    nchase = std::max((naccesses + n - 1) / n, 1UL) * n;
+                }
+            }
+            for (perf_event_id e : {perf_llc_misses, perf_dtlb_misses}) {
+                if (pc && pc->available(e) && nchase) {
+                    printf(" %10.3f", pc->value(e) / (double) nchase);
+                } else if (pc) {
+                    printf(" %10s", "-");
+                }
+            }
+            if (alloc.huge != huge_none) {
+                printf(" %6.0f", big_huge_percent(data_mem));
+            }
+            printf("\n");
+            big_free(index_mem);
+            big_free(data_mem);
+        }
+    }
+    delete pc;
+    return 0;
+}
+
+
+// Optimized modes
+//
+// Usage: ./arrayaccess [-p DISTANCE] [-g] [OPTIONS] [SIZE]
+//    After the plain loop, time an optimized version of the same
+//    `sum += data[index[i]]` loop and report its speedup over a scalar
+//    baseline without prefetching or index checks. `-p DISTANCE`
+//    issues `__builtin_prefetch(&data[index[i + DISTANCE]])` on every
+//    access, so the cache miss for a later element overlaps the current
+//    one. `-g` uses AVX2 `vpgatherdd` to load eight elements per
+//    instruction (combined with `-p` if both are given; plain scalar code
+//    if the CPU lacks AVX2).
+//
+//    Prefetching pays off for random indexes, whose misses the hardware
+//    prefetcher cannot predict, once the data array is much bigger than
+//    the cache; a good DISTANCE covers memory latency divided by the time
+//    per element (try 8–64). For sequential indexes the hardware
+//    prefetcher already runs ahead, so expect no speedup there.
+
+static unsigned sum_prefetch(const int* index, const int* data, int n,
+                             int distance) {
+    unsigned sum = 0;
+    int i = 0;
+    if (distance > 0) {
+        for (; i < n - distance; ++i) {
+            __builtin_prefetch(&data[index[i + distance]]);
+            sum += (unsigned) data[index[i]];
+        }
+    }
+    // distance 0 (the baseline) is a plain loop with no prefetches
+    for (; i < n; ++i) {
+        sum += (unsigned) data[index[i]];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static unsigned sum_gather_avx2(const int* index, const int* data, int n,
+                                int distance) {
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        if (distance > 0 && i + distance + 8 <= n) {
+            for (int j = 0; j != 8; ++j) {
+                __builtin_prefetch(&data[index[i + distance + j]]);
+            }
+        }
+        __m256i idx = _mm256_loadu_si256((const __m256i*) &index[i]);
+        acc = _mm256_add_epi32(acc, _mm256_i32gather_epi32(data, idx, 4));
+    }
+    unsigned lanes[8];
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+    unsigned sum = 0;
+    for (int j = 0; j != 8; ++j) {
+        sum += lanes[j];
+    }
+    for (; i < n; ++i) {
+        sum += (unsigned) data[index[i]];
+    }
+    return sum;
+}
+
+// Return the time to run the `sum_prefetch` or `sum_gather_avx2` loop
+// `qsi.repeats` times, checking the sum.
+static double time_optimized(const qs_info& qsi, const int* data,
+                             bool gather, int distance) {
+    double start = tstamp();
+    unsigned sum = 0;
+    for (unsigned int rep = 0; rep < qsi.repeats; ++rep) {
+        if (gather) {
+            sum += sum_gather_avx2(qsi.array, data, qsi.size, distance);
+        } else {
+            sum += sum_prefetch(qsi.array, data, qsi.size, distance);
+        }
+    }
+    double elapsed = tstamp() - start;
+    assert(sum == qsi.checksum * qsi.repeats);
+    return elapsed;
+}
+
+static void run_optimized(const qs_info& qsi, const int* data,
+                          perf_counters* pc) {
+    bool gather = qsi.gather && __builtin_cpu_supports("avx2");
+    if (qsi.gather && !gather) {
+        fprintf(stderr, "AVX2 unavailable, using scalar loop\n");
+    }
+    char name[64];
+    int len = snprintf(name, sizeof(name), "%s", gather ? "gather" : "scalar");
+    if (qsi.prefetch) {
+        snprintf(name + len, sizeof(name) - len, ", prefetch distance %d",
+                 qsi.prefetch);
+    }
+
+    // baseline: the same scalar loop with no prefetch (the plain loop
+    // above also checks every index, so it is not a fair baseline)
+    double base_elapsed = time_optimized(qsi, data, false, 0);
+    printf("scalar baseline: OK in %.06f sec\n", base_elapsed);
+
+    if (pc) {
+        pc->start();
+    }
+    double elapsed = time_optimized(qsi, data, gather, qsi.prefetch);
+    if (pc) {
+        pc->stop();
+    }
+
+    printf("%s: OK in %.06f sec (%.2fx speedup)\n", name, elapsed,
+           elapsed > 0 ? base_elapsed / elapsed : 1.0);
+    if (pc) {
+        pc->print(stdout, (uint64_t) qsi.size * qsi.repeats);
+    }
+}
+
+
+// JIT mode
+//
+// Usage: ./arrayaccess -J [-a ACCESSES] [-U UNROLL] [BYTES]
+//    For strides of 1, 2, 4, ..., 1024 ints, sum every stride'th int of a
+//    BYTES-byte array (default 32 KiB, so the loads hit in the L1 cache
+//    and the loop itself is the bottleneck) two ways, and print
+//    nanoseconds per element summed:
+//
+//    - `compiled`: `sum_strided`, the loop compiled ahead of time with the
+//      size and stride as run-time arguments.
+//    - `unrolled`: `sum_strided_unrolled`, the same loop unrolled 8 times
+//      by hand with four rotating accumulators, like the JIT kernel, so
+//      the `jit` column's gain over it comes from specialization alone.
+//    - `jit`: a `jit_sum` kernel (jitsum.hh) generated for this size and
+//      stride, unrolled UNROLL times (default 8), with the offsets as
+//      constants.
+//
+//    The speedup column compares `jit` with `unrolled`.
+//
+//    Each measurement sums at least ACCESSES elements (default 2^26).
+//    Specialization pays off only while the loop's own instructions are
+//    the bottleneck; for arrays much larger than the cache, both versions
+//    wait on memory at the same rate. The compiler also vectorizes the
+//    stride-1 loop, which the scalar JIT kernel does not.
+
+__attribute__((noinline))
+static unsigned sum_strided(const int* data, int n, int stride) {
+    unsigned sum = 0;
+    for (int i = 0; i < n; i += stride) {
+        sum += (unsigned) data[i];
+    }
+    return sum;
+}
+
+__attribute__((noinline))
+static unsigned sum_strided_unrolled(const int* data, int n, int stride) {
+    unsigned s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    long i = 0, step = 8 * (long) stride;
+    for (; i + 7 * (long) stride < n; i += step) {
+        s0 += (unsigned) data[i];
+        s1 += (unsigned) data[i + stride];
+        s2 += (unsigned) data[i + 2 * stride];
+        s3 += (unsigned) data[i + 3 * stride];
+        s0 += (unsigned) data[i + 4 * stride];
+        s1 += (unsigned) data[i + 5 * stride];
+        s2 += (unsigned) data[i + 6 * stride];
+        s3 += (unsigned) data[i + 7 * stride];
+    }
+    for (; i < n; i += stride) {
+        s0 += (unsigned) data[i];
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+static int jit(int argc, char* argv[]) {
+    unsigned long bytes = 32768;
+    unsigned long naccesses = 1UL << 26;
+    int unroll = 8;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "-a") == 0 && i + 1 < argc
+            && strisnumber(argv[i + 1])) {
+            naccesses = strtoul(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strcmp(argv[i], "-U") == 0 && i + 1 < argc
+                   && strisnumber(argv[i + 1]) && atoi(argv[i + 1]) > 0) {
+            unroll = atoi(argv[i + 1]);
+            ++i;
+        } else if (strisnumber(argv[i]) && strtoul(argv[i], NULL, 0) >= 4) {
+            bytes = strtoul(argv[i], NULL, 0);
+        } else {
+            fprintf(stderr, "Usage: %s -J [-a ACCESSES] [-U UNROLL] [BYTES]\n", argv[0]);
+            exit(1);
+        }
+    }
+    bytes = std::min(bytes, (unsigned long) INT_MAX * sizeof(int));
+    int n = bytes / sizeof(int);
+    int* data = new int[n];
+    initialize_random(data, n);
+
+    printf("%8s %10s %10s %10s %10s %10s\n",
+           "stride", "compiled", "unrolled", "jit", "speedup", "code");
+    for (int stride = 1; stride <= 1024 && stride < n; stride *= 2) {
+        jit_sum js(n, stride, unroll);
+        if (!js.function()) {
+            fprintf(stderr, "%s: cannot generate code for stride %d\n",
+                    argv[0], stride);
+            exit(1);
+        }
+        unsigned long count = (n - 1) / stride + 1;
+        unsigned long reps = std::max(naccesses / count, 1UL);
+        unsigned expected = 0;
+        for (int i = 0; i < n; i += stride) {
+            expected += (unsigned) data[i];
+        }
+
+        double start = tstamp();
+        unsigned sum = 0;
+        for (unsigned long r = 0; r != reps; ++r) {
+            sum += sum_strided(data, n, stride);
+            asm volatile("" : : : "memory");   // don't hoist the call
+        }
+        double compiled_ns = (tstamp() - start) * 1e9 / (reps * count);
+        assert(sum == expected * (unsigned) reps);
+
+        start = tstamp();
+        sum = 0;
+        for (unsigned long r = 0; r != reps; ++r) {
+            sum += sum_strided_unrolled(data, n, stride);
+            asm volatile("" : : : "memory");   // don't hoist the call
+        }
+        double unrolled_ns = (tstamp() - start) * 1e9 / (reps * count);
+        assert(sum == expected * (unsigned) reps);
+
+        jit_sum_function f = js.function();
+        start = tstamp();
+        sum = 0;
+        for (unsigned long r = 0; r != reps; ++r) {
+            sum += f(data);
+            asm volatile("" : : : "memory");   // don't hoist the call
+        }
+        double jit_ns = (tstamp() - start) * 1e9 / (reps * count);
+        assert(sum == expected * (unsigned) reps);
+
+        printf("%8d %10.3f %10.3f %10.3f %9.2fx %10zu\n", stride,
+               compiled_ns, unrolled_ns, jit_ns, unrolled_ns / jit_ns,
+               js.code_size());
+        fflush(stdout);
+    }
+    printf("(ns/element; code in bytes)\n");
+    delete[] data;
+    return 0;
+}
+
+
+// Streaming mode
+//
+// Usage: ./arrayaccess -L [-r|-u|-s STRIDE] [-c CHUNK] [-f FILE] SIZE
+//    Sum a data array of SIZE ints (a 64-bit count) in random (`-r`, the
+//    default), sequential (`-u`), or strided order, without storing an
+//    index array. Indexes are generated CHUNK (default 65536) at a time
+//    into a small buffer. For random order, a `feistel_permutation`
+//    (feistel.hh) maps position k to its index. Only the data array has to
+//    fit in memory, so with `-f` the working set can exceed RAM.
+//
+//    With `-f FILE`, the data array is a shared mapping of FILE, and the
+//    kernel pages it in and out as needed; the report includes the major
+//    page faults this causes. The file is written with `data[i] == i` on
+//    first use and reused by later runs of the same SIZE (after
+//    spot-checking its contents). Without `-f`, the data array is
+//    anonymous memory, which must fit in RAM plus swap.
+//
+//    The report also gives the cost of generating the indexes alone, so it
+//    can be subtracted from small, cache-resident runs.
+
+struct index_stream {
+    uint64_t n;
+    char pattern;               // 'r', 'u', or 's'
+    uint64_t stride;
+    feistel_permutation perm;
+    uint64_t k = 0;             // # indexes generated
+    uint64_t start = 0;         // strided: current starting offset
+    uint64_t i = 0;             // strided: next index
+
+    index_stream(uint64_t n_, char pattern_, uint64_t stride_)
+        : n(n_), pattern(pattern_), stride(stride_), perm(n_, 61) {
+    }
+
+    // Write up to `count` more indexes to `buf`; return the number written.
+    size_t fill(uint64_t* buf, size_t count) {
+        size_t m = std::min((uint64_t) count, this->n - this->k);
+        if (this->pattern == 'r') {
+            for (size_t j = 0; j != m; ++j) {
+                buf[j] = this->perm(this->k + j);
+            }
+        } else if (this->pattern == 'u') {
+            for (size_t j = 0; j != m; ++j) {
+                buf[j] = this->k + j;
+            }
+        } else {
+            for (size_t j = 0; j != m; ++j) {
+                if (this->i >= this->n) {
+                    ++this->start;
+                    this->i = this->start;
+                }
+                buf[j] = this->i;
+                this->i += this->stride;
+            }
+        }
+        this->k += m;
+        return m;
+    }
+};
+
+// Return true if the first `n` ints of `fd` appear to hold `data[i] == i`.
+static bool stream_file_ok(int fd, uint64_t n) {
+    feistel_permutation perm(n, 17);
+    for (uint64_t j = 0; j != 64 && j != n; ++j) {
+        uint64_t i = perm(j);
+        int x;
+        if (pread(fd, &x, sizeof(x), i * sizeof(int)) != sizeof(x)
+            || x != (int) i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Return the data array for streaming mode, mapping `file` if nonnull.
+static int* stream_data(uint64_t n, const char* file, char pattern) {
+    size_t bytes = n * sizeof(int);
+    void* p;
+    if (!file) {
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            perror("mmap");
+            exit(1);
+        }
+        int* data = (int*) p;
+        for (uint64_t i = 0; i != n; ++i) {
+            data[i] = (int) i;
+        }
+        return data;
+    }
+
+    int fd = open(file, O_RDWR | O_CREAT, 0666);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(file);
+        exit(1);
+    }
+    if ((uint64_t) st.st_size != bytes || !stream_file_ok(fd, n)) {
+        printf("writing %zu MiB to %s...\n", bytes >> 20, file);
+        fflush(stdout);
+        if (ftruncate(fd, 0) != 0) {
+            perror(file);
+            exit(1);
+        }
+        std::vector<int> buf(1 << 18);
+        for (uint64_t i = 0; i < n; i += buf.size()) {
+            size_t m = std::min((uint64_t) buf.size(), n - i);
+            for (size_t j = 0; j != m; ++j) {
+                buf[j] = (int) (i + j);
+            }
+            size_t w = m * sizeof(int), pos = 0;
+            while (pos < w) {
+                ssize_t r = write(fd, (char*) buf.data() + pos, w - pos);
+                if (r <= 0) {
+                    perror(file);
+                    exit(1);
+                }
+                pos += r;
+            }
+        }
+    }
+    p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    close(fd);
+    madvise(p, bytes, pattern == 'u' ? MADV_SEQUENTIAL : MADV_RANDOM);
+    return (int*) p;
+}
+
+static long major_faults() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_majflt;
+}
+
+static int stream(int argc, char* argv[]) {
+    char pattern = 'r';
+    uint64_t stride = 1, n = 0;
+    size_t chunk = 65536;
+    const char* file = nullptr;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "-u") == 0) {
+            pattern = argv[i][1];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc
+                   && strisnumber(argv[i + 1]) && atol(argv[i + 1]) > 0) {
+            pattern = 's';
+            stride = strtoul(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc
+                   && strisnumber(argv[i + 1]) && atol(argv[i + 1]) > 0) {
+            chunk = strtoul(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            file = argv[i + 1];
+            ++i;
+        } else if (strisnumber(argv[i]) && n == 0) {
+            n = strtoull(argv[i], NULL, 0);
+        } else {
+            n = 0;
+            break;
+        }
+    }
+    if (n == 0) {
+        fprintf(stderr, "Usage: %s -L [-r|-u|-s STRIDE] [-c CHUNK] [-f FILE] SIZE\n", argv[0]);
+        exit(1);
+    }
+
+    int* data = stream_data(n, file, pattern);
+    std::vector<uint64_t> index(chunk);
+    const char* name = pattern == 'r' ? "random"
+        : (pattern == 'u' ? "sequential" : "strided");
+    printf("streaming %" PRIu64 " integers (%" PRIu64 " MiB, %s) in %s order, %zu indexes at a time:\n",
+           n, (n * sizeof(int)) >> 20, file ? file : "anonymous memory",
+           name, chunk);
+
+    // index generation alone, over up to 2^24 indexes
+    index_stream gen(n, pattern, stride);
+    uint64_t ngen = 0, genmax = std::min(n, (uint64_t) 1 << 24);
+    unsigned gensum = 0;
+    double start = tstamp();
+    while (ngen < genmax) {
+        size_t m = gen.fill(index.data(), std::min((uint64_t) chunk, genmax - ngen));
+        gensum += (unsigned) index[m - 1];
+        ngen += m;
+    }
+    double gen_ns = (tstamp() - start) * 1e9 / ngen;
+    asm volatile("" : : "r"(gensum));
+
+    index_stream s(n, pattern, stride);
+    long faults = major_faults();
+    start = tstamp();
+    unsigned sum = 0;
+    while (size_t m = s.fill(index.data(), chunk)) {
+        for (size_t j = 0; j != m; ++j) {
+            sum += (unsigned) data[index[j]];
+        }
+    }
+    double elapsed = tstamp() - start;
+    faults = major_faults() - faults;
+
+    // each order visits every index once, and `data[i] == (int) i`
+    uint64_t expected = n % 2 ? n * ((n - 1) / 2) : (n / 2) * (n - 1);
+    assert(sum == (unsigned) expected);
+    printf("OK in %.06f sec! %.3f ns/access (%.3f generating indexes), %ld major faults\n",
+           elapsed, elapsed * 1e9 / n, gen_ns, faults);
+    munmap(data, n * sizeof(int));
+    return 0;
+}
+
 
 int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "-S") == 0) {
+        return sweep(argc, argv);
+    } else if (argc > 1 && strcmp(argv[1], "-J") == 0) {
+        return jit(argc, argv);
+    } else if (argc > 1 && strcmp(argv[1], "-L") == 0) {
+        return stream(argc, argv);
+    }
     qs_info qsi = parse_arguments(argc, argv);
     assert(strcmp(qsi.pattern, "magic") != 0);
 
     // initialize data array
-    int* data = new int[qsi.size];
+    big_array data_mem = big_alloc(qsi.size * sizeof(int), qsi.alloc);
+    int* data = (int*) data_mem.ptr;
     initialize_up(data, qsi.size);
+    big_report(qsi.array_mem, "index", stdout);
+    big_report(data_mem, "data", stdout);
 
     printf("accessing %d integers %u times in %s order:\n", qsi.size, qsi.repeats, qsi.pattern);
     ints_print(qsi.array, qsi.size);
 
     // sum elements of `data` array;
-    // access array in order defined by `-r/-u/-d` argument
-    double start = timestamp();
+    // access array in order defined by the pattern argument
+    perf_counters* pc = qsi.counters ? new perf_counters : nullptr;
+    if (pc) {
+        pc->start();
+    }
+    double start = tstamp();
     unsigned sum = 0;
     for (unsigned int rep = 0; rep < qsi.repeats; ++rep) {
       for (int i = 0; i != qsi.size; ++i) {
@@ -22,12 +664,23 @@ int main(int argc, char* argv[]) {
           sum += (unsigned) data[data_index];
       }
     }
+    if (pc) {
+        pc->stop();
+    }
+
+    // check the checksum (`data[i] == i`, so each pass sums `qsi.array`)
+    double elapsed = tstamp() - start;
+    assert(sum == qsi.checksum * qsi.repeats);
+    printf("OK in %.06f sec!\n", elapsed);
+    if (pc) {
+        pc->print(stdout, (uint64_t) qsi.size * qsi.repeats);
+    }
 
-    // check the checksum
-    unsigned long lsize = qsi.size;
-    assert(sum == (unsigned) ((lsize * (lsize - 1)) / 2) * qsi.repeats);
-    printf("OK in %.06f sec!\n", timestamp() - start);
+    if (qsi.prefetch > 0 || qsi.gather) {
+        run_optimized(qsi, data, pc);
+    }
+    delete pc;
 
-    delete[] qsi.array;
-    delete[] data;
+    big_free(qsi.array_mem);
+    big_free(data_mem);
 }
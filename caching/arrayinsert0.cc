@@ -0,0 +1,35 @@
+#include "qslib.hh"
+#include "allowexec.hh"
+
+// Usage: ./arrayinsert0 [-r|-u|-d|-s STRIDE|...] [SIZE]
+//    Insert the SIZE integers of an initialization pattern (see
+//    parse_arguments in qslib.cc; default random) one at a time into a
+//    sorted `std::vector`, keeping it sorted, then verify the result with
+//    `ints_sorted`. Each insert binary-searches for its position, and
+//    `insert` then moves every later element up one slot with `memmove`:
+//    O(n) work per insert, but sequential, prefetch-friendly work.
+//
+//    The arrayinsert programs differ only in the container:
+//    arrayinsert0 (vector), arrayinsert1 (`std::list`, linear search),
+//    arrayinsert2 (B+ tree), arrayinsert3 (packed-memory array).
+
+int main(int argc, char* argv[]) {
+    qs_info qsi = parse_arguments(argc, argv);
+    printf("inserting %d integers in %s order into a sorted vector:\n",
+           qsi.size, qsi.pattern);
+    ints_print(qsi.array, qsi.size);
+
+    double start = tstamp();
+    std::vector<int> x;
+    for (int i = 0; i != qsi.size; ++i) {
+        int v = qsi.array[i];
+        x.insert(std::upper_bound(x.begin(), x.end(), v), v);
+    }
+    double elapsed = tstamp() - start;
+
+    ints_print(x);
+    assert(x.size() == (size_t) qsi.size);
+    assert(ints_sorted(x) && ints_checksum(x) == qsi.checksum);
+    printf("OK in %.06f sec!\n", elapsed);
+    big_free(qsi.array_mem);
+}
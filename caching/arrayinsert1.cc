@@ -0,0 +1,35 @@
+#include "qslib.hh"
+#include "allowexec.hh"
+
+// Usage: ./arrayinsert1 [-r|-u|-d|-s STRIDE|...] [SIZE]
+//    Like arrayinsert0, but insert into a sorted `std::list`. A list
+//    insert moves nothing, but a list cannot be binary-searched: each
+//    insert walks the list from the front to find its position, one
+//    dependent cache miss per node once the list outgrows the cache.
+//    Sequential (`-u`) input is the worst case here and the best case
+//    for arrayinsert0; reverse (`-d`) input is the reverse.
+
+int main(int argc, char* argv[]) {
+    qs_info qsi = parse_arguments(argc, argv);
+    printf("inserting %d integers in %s order into a sorted list:\n",
+           qsi.size, qsi.pattern);
+    ints_print(qsi.array, qsi.size);
+
+    double start = tstamp();
+    std::list<int> x;
+    for (int i = 0; i != qsi.size; ++i) {
+        int v = qsi.array[i];
+        auto it = x.begin();
+        while (it != x.end() && *it <= v) {
+            ++it;
+        }
+        x.insert(it, v);
+    }
+    double elapsed = tstamp() - start;
+
+    ints_print(x);
+    assert(x.size() == (size_t) qsi.size);
+    assert(ints_sorted(x) && ints_checksum(x) == qsi.checksum);
+    printf("OK in %.06f sec!\n", elapsed);
+    big_free(qsi.array_mem);
+}
@@ -0,0 +1,27 @@
+#include "qslib.hh"
+#include "allowexec.hh"
+
+// Usage: ./arrayinsert2 [-r|-u|-d|-s STRIDE|...] [SIZE]
+//    Like arrayinsert0, but insert into a `btree_ints` (intset.hh): a B+
+//    tree whose leaves are small sorted arrays. Each insert touches
+//    O(log n) nodes and moves at most a leaf's worth of integers.
+
+int main(int argc, char* argv[]) {
+    qs_info qsi = parse_arguments(argc, argv);
+    printf("inserting %d integers in %s order into a B+ tree:\n",
+           qsi.size, qsi.pattern);
+    ints_print(qsi.array, qsi.size);
+
+    double start = tstamp();
+    btree_ints x;
+    for (int i = 0; i != qsi.size; ++i) {
+        x.insert(qsi.array[i]);
+    }
+    double elapsed = tstamp() - start;
+
+    ints_print(x);
+    assert(x.size() == (size_t) qsi.size);
+    assert(ints_sorted(x) && ints_checksum(x) == qsi.checksum);
+    printf("OK in %.06f sec!\n", elapsed);
+    big_free(qsi.array_mem);
+}
@@ -0,0 +1,29 @@
+#include "qslib.hh"
+#include "allowexec.hh"
+
+// Usage: ./arrayinsert3 [-r|-u|-d|-s STRIDE|...] [SIZE]
+//    Like arrayinsert0, but insert into a `pma_ints` (intset.hh): a
+//    sorted array with gaps, so an insert usually shifts only a few
+//    neighbors, and the gaps are occasionally respread. Traversal stays a
+//    sequential scan. Sorted and reverse-sorted input are its hard case:
+//    every insert lands at one end, so that region respreads constantly.
+
+int main(int argc, char* argv[]) {
+    qs_info qsi = parse_arguments(argc, argv);
+    printf("inserting %d integers in %s order into a packed-memory array:\n",
+           qsi.size, qsi.pattern);
+    ints_print(qsi.array, qsi.size);
+
+    double start = tstamp();
+    pma_ints x;
+    for (int i = 0; i != qsi.size; ++i) {
+        x.insert(qsi.array[i]);
+    }
+    double elapsed = tstamp() - start;
+
+    ints_print(x);
+    assert(x.size() == (size_t) qsi.size);
+    assert(ints_sorted(x) && ints_checksum(x) == qsi.checksum);
+    printf("OK in %.06f sec!\n", elapsed);
+    big_free(qsi.array_mem);
+}
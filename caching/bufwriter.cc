@@ -0,0 +1,94 @@
+#include "bufwriter.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+
+bufwriter::bufwriter(int fd, size_t buffer_size)
+    : fd_(fd), cap_(buffer_size) {
+    if (buffer_size < min_buffer_size || buffer_size > max_buffer_size) {
+        fprintf(stderr, "bufwriter: buffer size must be between %zu and %zu\n",
+                min_buffer_size, max_buffer_size);
+        exit(1);
+    }
+    this->buf_ = (char*) malloc(buffer_size);
+    if (!this->buf_) {
+        perror("malloc");
+        exit(1);
+    }
+}
+
+bufwriter::~bufwriter() {
+    this->flush();
+    free(this->buf_);
+}
+
+int bufwriter::flush() {
+    if (this->err_) {
+        return -1;
+    }
+    size_t w = this->write_fd(this->buf_, this->pos_);
+    if (w < this->pos_) {
+        // keep the unwritten bytes, as stdio does
+        memmove(this->buf_, this->buf_ + w, this->pos_ - w);
+        this->pos_ -= w;
+        return -1;
+    }
+    this->pos_ = 0;
+    return 0;
+}
+
+// Handle a write that doesn't fit in the buffer's free space.
+size_t bufwriter::fwrite_slow(const void* ptr, size_t size, size_t nmemb) {
+    if (this->err_) {
+        return 0;
+    }
+    const char* p = (const char*) ptr;
+    size_t sz = size * nmemb, done = 0;
+    if (this->pos_ > 0) {
+        // top off the buffer, then write it
+        done = this->cap_ - this->pos_;
+        memcpy(this->buf_ + this->pos_, p, done);
+        this->pos_ = this->cap_;
+        if (this->flush() != 0) {
+            // the topped-off bytes are still buffered; report the items
+            // that are entirely buffered or written
+            return done / size;
+        }
+    }
+    if (sz - done >= this->cap_) {
+        // a large write goes straight to the file
+        size_t n = sz - done - (sz - done) % this->cap_;
+        size_t w = this->write_fd(p + done, n);
+        done += w;
+        if (w < n) {
+            return done / size;
+        }
+    }
+    memcpy(this->buf_, p + done, sz - done);
+    this->pos_ = sz - done;
+    return nmemb;
+}
+
+// Write `sz` bytes to the file descriptor, retrying short writes and
+// interrupted calls. Returns the number of bytes written, which is less
+// than `sz` only on error. A nonblocking descriptor that would block
+// (EAGAIN) is an error, as is a `write` that returns 0.
+size_t bufwriter::write_fd(const char* p, size_t sz) {
+    size_t pos = 0;
+    while (pos < sz) {
+        ssize_t w = ::write(this->fd_, p + pos, sz - pos);
+        ++this->nsyscalls_;
+        if (w > 0) {
+            pos += w;
+        } else if (w == 0) {
+            this->err_ = EIO;
+            break;
+        } else if (errno != EINTR) {
+            this->err_ = errno;
+            break;
+        }
+    }
+    this->nwritten_ += pos;
+    return pos;
+}
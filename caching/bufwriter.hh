@@ -0,0 +1,84 @@
+#ifndef BUFWRITER_HH
+#define BUFWRITER_HH
+#include <cstring>
+#include <sys/types.h>
+
+// bufwriter
+//    A buffered output stream owned by a single thread.
+//
+//    A stdio `FILE*` may be shared between threads, so every `fwrite` and
+//    `putc` takes the stream's lock, even in programs that never share it.
+//    A `bufwriter` has exactly one owner, so it needs no lock: a write that
+//    fits in the buffer is a bounds check and a `memcpy`, inlined into the
+//    caller. When the buffer fills, it is written with one `write` system
+//    call; writes at least as large as the buffer bypass it.
+//
+//    `fwrite` has stdio semantics: it returns the number of whole items
+//    written, which is less than `nmemb` only if an error occurred.
+//    After an error, `error()` returns the `errno` value, and later writes
+//    fail. `flush()` writes any buffered data and returns 0, or -1 on
+//    error; the destructor flushes but does not close the descriptor.
+//
+//    The buffer size must be between `min_buffer_size` (64 KiB) and
+//    `max_buffer_size` (8 MiB).
+
+struct bufwriter {
+    static constexpr size_t min_buffer_size = 64 << 10;
+    static constexpr size_t max_buffer_size = 8 << 20;
+
+    explicit bufwriter(int fd, size_t buffer_size = min_buffer_size);
+    ~bufwriter();
+    bufwriter(const bufwriter&) = delete;
+    bufwriter& operator=(const bufwriter&) = delete;
+
+    size_t fwrite(const void* ptr, size_t size, size_t nmemb) {
+        size_t sz = size * nmemb;
+        if (sz == 0) {
+            return 0;
+        }
+        if (sz <= this->cap_ - this->pos_) {
+            memcpy(this->buf_ + this->pos_, ptr, sz);
+            this->pos_ += sz;
+            return nmemb;
+        }
+        return this->fwrite_slow(ptr, size, nmemb);
+    }
+
+    int putc(int c) {
+        if (this->pos_ == this->cap_ && this->flush() != 0) {
+            return -1;
+        }
+        this->buf_[this->pos_++] = c;
+        return (unsigned char) c;
+    }
+
+    int flush();
+
+    int error() const {
+        return this->err_;
+    }
+    size_t buffer_size() const {
+        return this->cap_;
+    }
+    size_t nsyscalls() const {
+        return this->nsyscalls_;
+    }
+    // Return the number of bytes written to the file descriptor.
+    size_t nwritten() const {
+        return this->nwritten_;
+    }
+
+  private:
+    int fd_;
+    char* buf_;
+    size_t cap_;
+    size_t pos_ = 0;            // # bytes in buffer
+    int err_ = 0;
+    size_t nsyscalls_ = 0;
+    size_t nwritten_ = 0;
+
+    size_t fwrite_slow(const void* ptr, size_t size, size_t nmemb);
+    size_t write_fd(const char* p, size_t sz);
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "cachepolicy.hh"
+#include <cstring>
+#include <list>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+const char* const cache_policy_names[] = {
+    "lru", "clock", "2q", "arc", "lfu", nullptr
+};
+
+// slot_list
+//    A recency list of slots, most recent first.
+struct slot_list {
+    std::list<size_t> l;
+    std::vector<std::list<size_t>::iterator> pos;
+
+    explicit slot_list(size_t nslots)
+        : pos(nslots) {
+    }
+    size_t size() const {
+        return this->l.size();
+    }
+    bool empty() const {
+        return this->l.empty();
+    }
+    void push_front(size_t slot) {
+        this->l.push_front(slot);
+        this->pos[slot] = this->l.begin();
+    }
+    void move_front(size_t slot) {
+        this->l.splice(this->l.begin(), this->l, this->pos[slot]);
+    }
+    // Move `slot` from list `from` to the front of this list.
+    void take_front(slot_list& from, size_t slot) {
+        this->l.splice(this->l.begin(), from.l, from.pos[slot]);
+        this->pos[slot] = this->l.begin();
+    }
+    size_t pop_back() {
+        size_t slot = this->l.back();
+        this->l.pop_back();
+        return slot;
+    }
+};
+
+// ghost_list
+//    A recency list of recently evicted block numbers (no data).
+struct ghost_list {
+    std::list<off_t> l;
+    std::unordered_map<off_t, std::list<off_t>::iterator> index;
+
+    size_t size() const {
+        return this->l.size();
+    }
+    void push_front(off_t blk) {
+        this->l.push_front(blk);
+        this->index[blk] = this->l.begin();
+    }
+    // Remove `blk` if present. Returns true if it was present.
+    bool erase(off_t blk) {
+        auto it = this->index.find(blk);
+        if (it == this->index.end()) {
+            return false;
+        }
+        this->l.erase(it->second);
+        this->index.erase(it);
+        return true;
+    }
+    void trim(size_t n) {
+        while (this->l.size() > n) {
+            this->index.erase(this->l.back());
+            this->l.pop_back();
+        }
+    }
+};
+
+
+// lru: evict the least recently used slot.
+struct lru_policy : cache_policy {
+    slot_list lru;
+
+    explicit lru_policy(size_t nslots)
+        : lru(nslots) {
+    }
+    const char* name() const override {
+        return "lru";
+    }
+    void insert(size_t slot, off_t) override {
+        this->lru.push_front(slot);
+    }
+    void touch(size_t slot) override {
+        this->lru.move_front(slot);
+    }
+    size_t evict() override {
+        return this->lru.pop_back();
+    }
+};
+
+
+// clock: approximate LRU with one reference bit per slot. The hand sweeps
+// the slots, clearing set bits, and evicts the first slot whose bit is
+// already clear.
+struct clock_policy : cache_policy {
+    std::vector<char> resident;
+    std::vector<char> ref;
+    size_t hand = 0;
+
+    explicit clock_policy(size_t nslots)
+        : resident(nslots, 0), ref(nslots, 0) {
+    }
+    const char* name() const override {
+        return "clock";
+    }
+    void insert(size_t slot, off_t) override {
+        this->resident[slot] = 1;
+        this->ref[slot] = 0;
+    }
+    void touch(size_t slot) override {
+        this->ref[slot] = 1;
+    }
+    size_t evict() override {
+        while (true) {
+            size_t slot = this->hand;
+            this->hand = (this->hand + 1) % this->ref.size();
+            if (this->resident[slot] && !this->ref[slot]) {
+                this->resident[slot] = 0;
+                return slot;
+            }
+            this->ref[slot] = 0;
+        }
+    }
+};
+
+
+// 2q (Johnson & Shasha): new blocks enter a FIFO, `a1in`. Blocks evicted
+// from `a1in` are remembered in the ghost list `a1out`; a block loaded
+// again while in `a1out` has been reused and goes to the LRU list `am`.
+// One-time scans therefore flush only `a1in`, not the hot blocks in `am`.
+struct twoq_policy : cache_policy {
+    slot_list a1in;
+    slot_list am;
+    ghost_list a1out;
+    std::vector<char> in_am;
+    std::vector<off_t> block;
+    size_t kin;
+    size_t kout;
+
+    explicit twoq_policy(size_t nslots)
+        : a1in(nslots), am(nslots), in_am(nslots, 0), block(nslots, -1),
+          kin(std::max(nslots / 4, (size_t) 1)),
+          kout(std::max(nslots / 2, (size_t) 1)) {
+    }
+    const char* name() const override {
+        return "2q";
+    }
+    void insert(size_t slot, off_t blk) override {
+        this->block[slot] = blk;
+        this->in_am[slot] = this->a1out.erase(blk);
+        if (this->in_am[slot]) {
+            this->am.push_front(slot);
+        } else {
+            this->a1in.push_front(slot);
+        }
+    }
+    void touch(size_t slot) override {
+        if (this->in_am[slot]) {
+            this->am.move_front(slot);
+        }
+    }
+    size_t evict() override {
+        if (this->a1in.size() > this->kin || this->am.empty()) {
+            size_t slot = this->a1in.pop_back();
+            this->a1out.push_front(this->block[slot]);
+            this->a1out.trim(this->kout);
+            return slot;
+        }
+        return this->am.pop_back();
+    }
+};
+
+
+// arc (Megiddo & Modha): resident blocks seen once live in `t1`, blocks
+// seen more than once in `t2`. Ghost lists `b1` and `b2` remember blocks
+// recently evicted from each. A miss that hits `b1` means `t1` was too
+// small, so the target size `p` of `t1` grows; a miss that hits `b2`
+// shrinks it.
+struct arc_policy : cache_policy {
+    slot_list t1;
+    slot_list t2;
+    ghost_list b1;
+    ghost_list b2;
+    std::vector<char> in_t2;
+    std::vector<off_t> block;
+    size_t c;
+    size_t p = 0;
+
+    explicit arc_policy(size_t nslots)
+        : t1(nslots), t2(nslots), in_t2(nslots, 0), block(nslots, -1),
+          c(nslots) {
+    }
+    const char* name() const override {
+        return "arc";
+    }
+    void insert(size_t slot, off_t blk) override {
+        this->block[slot] = blk;
+        size_t n1 = this->b1.size(), n2 = this->b2.size();
+        if (this->b1.erase(blk)) {
+            this->p = std::min(this->p + std::max(n2 / n1, (size_t) 1), this->c);
+            this->in_t2[slot] = 1;
+        } else if (this->b2.erase(blk)) {
+            size_t d = std::max(n1 / n2, (size_t) 1);
+            this->p = this->p > d ? this->p - d : 0;
+            this->in_t2[slot] = 1;
+        } else {
+            this->in_t2[slot] = 0;
+        }
+        if (this->in_t2[slot]) {
+            this->t2.push_front(slot);
+        } else {
+            this->t1.push_front(slot);
+        }
+    }
+    void touch(size_t slot) override {
+        if (this->in_t2[slot]) {
+            this->t2.move_front(slot);
+        } else {
+            this->t2.take_front(this->t1, slot);
+            this->in_t2[slot] = 1;
+        }
+    }
+    size_t evict() override {
+        size_t slot;
+        if (!this->t1.empty()
+            && (this->t1.size() > this->p || this->t2.empty())) {
+            slot = this->t1.pop_back();
+            this->b1.push_front(this->block[slot]);
+        } else {
+            slot = this->t2.pop_back();
+            this->b2.push_front(this->block[slot]);
+        }
+        // directory holds at most `c` blocks seen once and `2c` in total
+        this->b1.trim(this->c > this->t1.size() ? this->c - this->t1.size() : 0);
+        size_t rest = this->t1.size() + this->b1.size() + this->t2.size();
+        this->b2.trim(2 * this->c > rest ? 2 * this->c - rest : 0);
+        return slot;
+    }
+};
+
+
+// lfu: evict the least frequently used slot, breaking ties by recency.
+// Use counts start over when a slot is reloaded.
+struct lfu_policy : cache_policy {
+    using key = std::tuple<size_t, unsigned long, size_t>;  // count, time, slot
+    std::set<key> order;
+    std::vector<key> keys;
+    unsigned long clock = 0;
+
+    explicit lfu_policy(size_t nslots)
+        : keys(nslots) {
+    }
+    const char* name() const override {
+        return "lfu";
+    }
+    void insert(size_t slot, off_t) override {
+        this->keys[slot] = key(1, ++this->clock, slot);
+        this->order.insert(this->keys[slot]);
+    }
+    void touch(size_t slot) override {
+        key& k = this->keys[slot];
+        this->order.erase(k);
+        k = key(std::get<0>(k) + 1, ++this->clock, slot);
+        this->order.insert(k);
+    }
+    size_t evict() override {
+        size_t slot = std::get<2>(*this->order.begin());
+        this->order.erase(this->order.begin());
+        return slot;
+    }
+};
+
+
+cache_policy* cache_policy_create(const char* name, size_t nslots) {
+    if (nslots == 0) {
+        return nullptr;
+    } else if (strcmp(name, "lru") == 0) {
+        return new lru_policy(nslots);
+    } else if (strcmp(name, "clock") == 0) {
+        return new clock_policy(nslots);
+    } else if (strcmp(name, "2q") == 0) {
+        return new twoq_policy(nslots);
+    } else if (strcmp(name, "arc") == 0) {
+        return new arc_policy(nslots);
+    } else if (strcmp(name, "lfu") == 0) {
+        return new lfu_policy(nslots);
+    } else {
+        return nullptr;
+    }
+}
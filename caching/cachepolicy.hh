@@ -0,0 +1,37 @@
+#ifndef CACHEPOLICY_HH
+#define CACHEPOLICY_HH
+#include <sys/types.h>
+
+// cache_policy
+//    A replacement policy for a cache of `nslots` numbered slots.
+//
+//    The cache owns the slots and the block -> slot index; the policy only
+//    decides which resident slot to give up. The cache tells the policy
+//    when a block is loaded into a slot (`insert`) and when a resident slot
+//    is used again (`touch`), and asks it for a slot to reuse (`evict`)
+//    when no slot is free. `evict` forgets the slot it returns; the slot
+//    is tracked again on its next `insert`. Callers must only call `evict`
+//    while at least one slot is resident.
+//
+//    The same policy objects drive the io61 read cache and the `cachesim`
+//    trace simulator, so simulated hit rates carry over to io61.
+
+struct cache_policy {
+    virtual ~cache_policy() = default;
+    virtual const char* name() const = 0;
+    // Block `blk` was just loaded into slot `slot`.
+    virtual void insert(size_t slot, off_t blk) = 0;
+    // Resident slot `slot` was used again.
+    virtual void touch(size_t slot) = 0;
+    // Choose a resident slot to reuse and stop tracking it.
+    virtual size_t evict() = 0;
+};
+
+// Names accepted by `cache_policy_create`, terminated by nullptr.
+extern const char* const cache_policy_names[];
+
+// Return a new policy named `name` ("lru", "clock", "2q", "arc", or
+// "lfu") for `nslots` slots, or nullptr if `name` is unknown.
+cache_policy* cache_policy_create(const char* name, size_t nslots);
+
+#endif
@@ -0,0 +1,301 @@
+#include "cachepolicy.hh"
+#include "allowexec.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <unistd.h>
+
+// Usage: ./cachesim [-p POLICIES] [-n SLOTCOUNTS] [-b BLOCKSIZE] [-o csv]
+//                   [TRACEFILE | -g GENERATOR [-N NREADS] [-F FILESIZE]
+//                                [-r READSIZE] [-s STRIDE] [-z SKEW]]
+//    Replay a trace of reads through a simulated slot cache once for every
+//    combination of replacement policy (comma-separated; default all of
+//    lru,clock,2q,arc,lfu) and slot count (comma-separated; default
+//    16,64,256,1024), and report hit rate and system calls saved.
+//
+//    TRACEFILE holds one `OFFSET SIZE` line per read, as written by
+//    `./read -T` (`-` means standard input). Alternatively `-g` generates a
+//    synthetic trace of NREADS reads of READSIZE bytes from a FILESIZE-byte
+//    file:
+//       seq      sequential, wrapping around at end of file
+//       rev      reverse sequential
+//       stride   every STRIDE-th offset, then wrap as `./read -p stride`
+//       random   uniformly random READSIZE-aligned offsets
+//       zipf     Zipf-distributed offsets with exponent SKEW (default 0.99);
+//                the hottest offsets are scattered through the file
+//       scan     zipf reads mixed with a sequential scan (1 read in 4),
+//                which tests scan resistance
+//
+//    The simulator models demand fetching with no readahead, so it
+//    isolates the replacement policy. Every run of adjacent missing blocks
+//    within one read costs one system call; the baseline is one system
+//    call per read, as in `./read` without `-c`.
+
+struct trace_read {
+    off_t pos;
+    size_t sz;
+};
+
+struct sim_result {
+    size_t naccesses = 0;
+    size_t nhits = 0;
+    size_t nsyscalls = 0;
+};
+
+static sim_result simulate(const std::vector<trace_read>& trace,
+                           const char* policy, size_t nslots,
+                           size_t block_size) {
+    cache_policy* p = cache_policy_create(policy, nslots);
+    std::vector<off_t> slot_block(nslots, -1);
+    std::unordered_map<off_t, size_t> index;
+    size_t nfree = nslots;
+    sim_result r;
+
+    for (auto& tr : trace) {
+        if (tr.sz == 0) {
+            continue;
+        }
+        bool in_run = false;
+        off_t last = (tr.pos + tr.sz - 1) / block_size;
+        for (off_t blk = tr.pos / block_size; blk <= last; ++blk) {
+            ++r.naccesses;
+            auto it = index.find(blk);
+            if (it != index.end()) {
+                ++r.nhits;
+                p->touch(it->second);
+                in_run = false;
+                continue;
+            }
+            if (!in_run) {
+                ++r.nsyscalls;
+                in_run = true;
+            }
+            size_t slot;
+            if (nfree > 0) {
+                slot = --nfree;
+            } else {
+                slot = p->evict();
+                index.erase(slot_block[slot]);
+            }
+            slot_block[slot] = blk;
+            index[blk] = slot;
+            p->insert(slot, blk);
+        }
+    }
+    delete p;
+    return r;
+}
+
+
+static std::vector<trace_read> read_trace(const char* filename) {
+    FILE* f = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (!f) {
+        perror(filename);
+        exit(1);
+    }
+    std::vector<trace_read> trace;
+    long long pos;
+    size_t sz;
+    while (fscanf(f, "%lld %zu", &pos, &sz) == 2) {
+        if (pos >= 0) {
+            trace.push_back({(off_t) pos, sz});
+        }
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+    return trace;
+}
+
+// zipf_sampler
+//    Draws ranks in [0, n) with probability proportional to 1/(rank+1)^s.
+struct zipf_sampler {
+    std::vector<double> cdf;
+
+    zipf_sampler(size_t n, double s)
+        : cdf(n) {
+        double sum = 0;
+        for (size_t i = 0; i != n; ++i) {
+            sum += 1 / pow(i + 1, s);
+            cdf[i] = sum;
+        }
+        for (auto& c : cdf) {
+            c /= sum;
+        }
+    }
+    template <typename R>
+    size_t operator()(R& rng) {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        size_t i = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return std::min(i, cdf.size() - 1);
+    }
+};
+
+static std::vector<trace_read> generate_trace(const char* gen, size_t nreads,
+                                              off_t filesize, size_t readsize,
+                                              off_t stride, double skew) {
+    std::vector<trace_read> trace;
+    std::mt19937_64 rng(61);
+    off_t nchunks = std::max(filesize / (off_t) readsize, (off_t) 1);
+    std::vector<off_t> perm(nchunks);
+    for (off_t i = 0; i != nchunks; ++i) {
+        perm[i] = i;
+    }
+    std::shuffle(perm.begin(), perm.end(), rng);
+    zipf_sampler zipf(strcmp(gen, "zipf") == 0 || strcmp(gen, "scan") == 0
+                      ? nchunks : 1, skew);
+
+    off_t pos = 0, stride_start = 0, scan = 0;
+    for (size_t i = 0; i != nreads; ++i) {
+        if (strcmp(gen, "seq") == 0) {
+            pos = (i % nchunks) * readsize;
+        } else if (strcmp(gen, "rev") == 0) {
+            pos = (nchunks - 1 - i % nchunks) * readsize;
+        } else if (strcmp(gen, "stride") == 0) {
+            if (i != 0 && pos + stride < filesize) {
+                pos += stride;
+            } else if (i != 0) {
+                stride_start = (stride_start + readsize) % stride;
+                pos = stride_start;
+            }
+        } else if (strcmp(gen, "random") == 0) {
+            pos = std::uniform_int_distribution<off_t>(0, nchunks - 1)(rng) * readsize;
+        } else if (strcmp(gen, "zipf") == 0 || i % 4 != 0) {
+            pos = perm[zipf(rng)] * readsize;
+        } else {
+            pos = (scan++ % nchunks) * readsize;
+        }
+        trace.push_back({pos, readsize});
+    }
+    return trace;
+}
+
+
+static std::vector<size_t> parse_numbers(const char* arg) {
+    std::vector<size_t> v;
+    std::string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t comma = std::min(s.find(',', pos), s.size());
+        std::string item = s.substr(pos, comma - pos);
+        if (!strisnumber(item.c_str()) || strtoul(item.c_str(), nullptr, 0) == 0) {
+            fprintf(stderr, "bad number `%s`\n", item.c_str());
+            exit(1);
+        }
+        v.push_back(strtoul(item.c_str(), nullptr, 0));
+        pos = comma + 1;
+    }
+    return v;
+}
+
+static std::vector<std::string> parse_policies(const char* arg) {
+    std::vector<std::string> v;
+    std::string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t comma = std::min(s.find(',', pos), s.size());
+        std::string item = s.substr(pos, comma - pos);
+        cache_policy* p = cache_policy_create(item.c_str(), 1);
+        if (!p) {
+            fprintf(stderr, "unknown policy `%s`\n", item.c_str());
+            exit(1);
+        }
+        delete p;
+        v.push_back(item);
+        pos = comma + 1;
+    }
+    return v;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [-p POLICIES] [-n SLOTCOUNTS] [-b BLOCKSIZE] [-o csv]\n"
+            "          [TRACEFILE | -g seq|rev|stride|random|zipf|scan [-N NREADS] [-F FILESIZE]\n"
+            "                       [-r READSIZE] [-s STRIDE] [-z SKEW]]\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> policies;
+    for (int i = 0; cache_policy_names[i]; ++i) {
+        policies.push_back(cache_policy_names[i]);
+    }
+    std::vector<size_t> slotcounts = {16, 64, 256, 1024};
+    size_t block_size = 4096, nreads = 1000000, readsize = 4096;
+    off_t filesize = 64 << 20, stride = 65536;
+    double skew = 0.99;
+    const char* gen = nullptr;
+    bool csv = false;
+    int ch;
+    while ((ch = getopt(argc, argv, "p:n:b:o:g:N:F:r:s:z:")) != -1) {
+        if (ch == 'p') {
+            policies = parse_policies(optarg);
+        } else if (ch == 'n') {
+            slotcounts = parse_numbers(optarg);
+        } else if (ch == 'b' && strisnumber(optarg)) {
+            block_size = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'o' && strcmp(optarg, "csv") == 0) {
+            csv = true;
+        } else if (ch == 'g' && (strcmp(optarg, "seq") == 0
+                                 || strcmp(optarg, "rev") == 0
+                                 || strcmp(optarg, "stride") == 0
+                                 || strcmp(optarg, "random") == 0
+                                 || strcmp(optarg, "zipf") == 0
+                                 || strcmp(optarg, "scan") == 0)) {
+            gen = optarg;
+        } else if (ch == 'N' && strisnumber(optarg)) {
+            nreads = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'F' && strisnumber(optarg)) {
+            filesize = strtoull(optarg, nullptr, 0);
+        } else if (ch == 'r' && strisnumber(optarg)) {
+            readsize = strtoul(optarg, nullptr, 0);
+        } else if (ch == 's' && strisnumber(optarg)) {
+            stride = strtoull(optarg, nullptr, 0);
+        } else if (ch == 'z') {
+            skew = strtod(optarg, nullptr);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (block_size == 0 || readsize == 0 || filesize <= 0
+        || (gen && strcmp(gen, "stride") == 0 && stride < (off_t) readsize)
+        || (gen != nullptr) == (optind < argc)) {
+        usage(argv[0]);
+    }
+
+    std::vector<trace_read> trace;
+    if (gen) {
+        trace = generate_trace(gen, nreads, filesize, readsize, stride, skew);
+    } else {
+        trace = read_trace(argv[optind]);
+    }
+
+    if (csv) {
+        printf("policy,slots,reads,accesses,hits,hit_rate,syscalls,syscalls_saved\n");
+    } else {
+        printf("%-6s %8s %12s %8s %12s %8s\n",
+               "policy", "slots", "accesses", "hit%", "syscalls", "saved%");
+    }
+    for (size_t nslots : slotcounts) {
+        for (auto& policy : policies) {
+            sim_result r = simulate(trace, policy.c_str(), nslots, block_size);
+            double hit_rate = r.naccesses ? r.nhits / (double) r.naccesses : 0;
+            double saved = trace.empty() ? 0 : 1 - r.nsyscalls / (double) trace.size();
+            if (csv) {
+                printf("%s,%zu,%zu,%zu,%zu,%.6f,%zu,%.6f\n",
+                       policy.c_str(), nslots, trace.size(), r.naccesses,
+                       r.nhits, hit_rate, r.nsyscalls, saved);
+            } else {
+                printf("%-6s %8zu %12zu %7.2f%% %12zu %7.2f%%\n",
+                       policy.c_str(), nslots, r.naccesses, 100 * hit_rate,
+                       r.nsyscalls, 100 * saved);
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include "directio.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+size_t direct_alignment() {
+    static size_t align = 0;
+    if (align == 0) {
+        long pagesize = sysconf(_SC_PAGESIZE);
+        align = pagesize > 0 ? pagesize : 4096;
+    }
+    return align;
+}
+
+size_t direct_round_up(size_t sz) {
+    size_t align = direct_alignment();
+    return (sz + align - 1) & ~(align - 1);
+}
+
+void* direct_alloc(size_t sz) {
+    // anonymous mappings are page-aligned and zero-filled
+    void* p = mmap(nullptr, direct_round_up(std::max(sz, (size_t) 1)),
+                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    return p;
+}
+
+void direct_free(void* ptr, size_t sz) {
+    if (ptr) {
+        munmap(ptr, direct_round_up(std::max(sz, (size_t) 1)));
+    }
+}
+
+
+direct_writer::direct_writer(int fd, size_t block_size)
+    : fd_(fd), block_size_(direct_round_up(std::max(block_size, (size_t) 1))) {
+    this->buf_ = (char*) direct_alloc(this->block_size_);
+    this->off_ = lseek(fd, 0, SEEK_CUR);
+    if (this->off_ < 0) {
+        perror("direct_writer: lseek");
+        exit(1);
+    }
+    if (this->off_ % direct_alignment() != 0) {
+        fprintf(stderr, "direct_writer: file offset is not aligned\n");
+        exit(1);
+    }
+    int flags = fcntl(fd, F_GETFL);
+    this->direct_ = flags >= 0 && fcntl(fd, F_SETFL, flags | O_DIRECT) == 0;
+}
+
+direct_writer::~direct_writer() {
+    this->flush();
+    direct_free(this->buf_, this->block_size_);
+}
+
+const char* direct_writer::method() const {
+    return this->direct_ ? "O_DIRECT" : "buffered (O_DIRECT unsupported)";
+}
+
+ssize_t direct_writer::write(const char* buf, size_t sz) {
+    size_t pos = 0;
+    if (sz > 0) {
+        this->tail_written_ = false;
+    }
+    while (pos < sz) {
+        size_t n = std::min(sz - pos, this->block_size_ - this->pos_);
+        memcpy(&this->buf_[this->pos_], &buf[pos], n);
+        this->pos_ += n;
+        pos += n;
+        if (this->pos_ == this->block_size_) {
+            this->write_block(this->block_size_);
+            this->off_ += this->block_size_;
+            this->pos_ = 0;
+        }
+    }
+    this->nwritten_ += sz;
+    return sz;
+}
+
+void direct_writer::flush() {
+    if (this->pos_ == 0 || this->tail_written_) {
+        return;
+    }
+    // pad the tail to an aligned length, write it, and trim the padding
+    size_t padded = direct_round_up(this->pos_);
+    memset(&this->buf_[this->pos_], 0, padded - this->pos_);
+    this->write_block(padded);
+    if (ftruncate(this->fd_, this->off_ + this->pos_) != 0) {
+        perror("ftruncate");
+        exit(1);
+    }
+    ++this->nsyscalls_;
+    // the buffer still holds the tail, so later writes can extend it
+    this->tail_written_ = true;
+}
+
+// Write the first `len` bytes of the buffer at `off_`.
+void direct_writer::write_block(size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t w = pwrite(this->fd_, &this->buf_[done], len - done,
+                           this->off_ + done);
+        ++this->nsyscalls_;
+        if (w < 0 && errno == EINVAL && this->direct_) {
+            this->disable_direct();
+        } else if (w < 0 && errno != EINTR) {
+            perror("pwrite");
+            exit(1);
+        } else if (w > 0) {
+            done += w;
+        }
+    }
+}
+
+void direct_writer::disable_direct() {
+    int flags = fcntl(this->fd_, F_GETFL);
+    if (flags < 0 || fcntl(this->fd_, F_SETFL, flags & ~O_DIRECT) != 0) {
+        perror("fcntl");
+        exit(1);
+    }
+    this->direct_ = false;
+}
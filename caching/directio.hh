@@ -0,0 +1,65 @@
+#ifndef DIRECTIO_HH
+#define DIRECTIO_HH
+#include <sys/types.h>
+
+// Page-aligned buffers for O_DIRECT. A page (4096 bytes on x86-64) is
+// at least as large as the logical block size of every common device,
+// so page alignment satisfies O_DIRECT's buffer, offset, and length
+// requirements.
+
+size_t direct_alignment();
+// Round `sz` up to a multiple of `direct_alignment()`.
+size_t direct_round_up(size_t sz);
+// Allocate `sz` bytes (rounded up) of zeroed, page-aligned memory, or
+// exit on failure.
+void* direct_alloc(size_t sz);
+void direct_free(void* ptr, size_t sz);
+
+// direct_writer
+//    A writer that bypasses the page cache with O_DIRECT.
+//
+//    Writes of any size are collected in an aligned buffer of `block_size`
+//    bytes (rounded up to `direct_alignment()`), which is written with
+//    `pwrite` whenever it fills. `flush()` handles an unaligned tail by
+//    writing the partial block padded with zeros and then truncating the
+//    file to its true length; the partial block stays buffered, so later
+//    writes simply rewrite it. Flushing again with no new data does nothing.
+//
+//    If the file system doesn't support O_DIRECT (for instance, tmpfs on
+//    older kernels), the writer clears O_DIRECT and continues with
+//    ordinary buffered writes; `method()` says which happened.
+
+struct direct_writer {
+    direct_writer(int fd, size_t block_size);
+    ~direct_writer();
+
+    // Write `sz` bytes from `buf`. Returns `sz`.
+    ssize_t write(const char* buf, size_t sz);
+    // Write all buffered data, including any unaligned tail.
+    void flush();
+
+    const char* method() const;
+    size_t nsyscalls() const {
+        return this->nsyscalls_;
+    }
+    // Return the number of bytes passed to `write`.
+    size_t nwritten() const {
+        return this->nwritten_;
+    }
+
+  private:
+    int fd_;
+    size_t block_size_;
+    char* buf_;
+    size_t pos_ = 0;            // # bytes in buffer
+    off_t off_;                 // file offset of buffer
+    bool direct_;               // O_DIRECT is in effect
+    bool tail_written_ = false; // buffer is already on disk at `off_`
+    size_t nsyscalls_ = 0;
+    size_t nwritten_ = 0;
+
+    void write_block(size_t len);
+    void disable_direct();
+};
+
+#endif
@@ -1,35 +1,46 @@
-#include "iobench.hh"
+#include "diskio.hh"
 
-int main() {
-    FILE* f = stdout;
-    if (isatty(fileno(f))) {
-        f = fopen(DATAFILE, "w");
-    }
-    if (!f) {
-        perror("fopen");
-        exit(1);
-    }
+int main(int argc, char* argv[]) {
+    diskio_options opt = parse_diskio_arguments(argc, argv, mode_stdio);
+    diskio_file f(opt, 0);
 
     size_t size = 51200000;
     size_t block_size = 512;
     char* buf = (char*) malloc(block_size);
     memset(buf, '6', block_size);
-    double start = tstamp();
+    perf_counters* pc = opt.counters ? new perf_counters : nullptr;
+    if (pc) {
+        pc->start();
+    }
+    progress_reporter progress(opt.interval);
 
     size_t n = 0;
     while (n < size) {
-        size_t r = fwrite(buf, 1, block_size, f);
-        if (r != block_size) {
+        ssize_t r = f.write(buf, block_size);
+        if (r != (ssize_t) block_size) {
             perror("write");
             exit(1);
         }
         n += r;
-        if (n % PRINT_FREQUENCY == 0) {
-            report(n, tstamp() - start);
-        }
+        progress.set(n);
     }
 
-    fclose(f);
-    report(n, tstamp() - start);
+    f.close();
+    if (pc) {
+        pc->stop();
+    }
+    double elapsed = progress.stop();
+    report(n, elapsed);
     fprintf(stderr, "\n");
+    if (opt.series) {
+        progress.print_series(stderr);
+    }
+    f.print_stats();
+    if (opt.latency) {
+        report_latency(f.lat);
+    }
+    if (pc) {
+        pc->print(stderr, n / block_size);
+        delete pc;
+    }
 }
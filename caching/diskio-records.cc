@@ -0,0 +1,114 @@
+#include "iobench.hh"
+#include "recwriter.hh"
+#include "allowexec.hh"
+
+// Usage: ./diskio-records [-m write|writev|pwritev2] [-n BATCHRECORDS]
+//                         [-B BATCHBYTES] [-r NRECORDS] [-l MINLEN] [-L MAXLEN] [-y]
+//                         [-i SECONDS] [-T]
+//    Append NRECORDS variable-length records (MINLEN to MAXLEN bytes each)
+//    to standard output, or to DATAFILE if standard output is a terminal.
+//    `-m write` issues one `write` per record; `-m writev` and
+//    `-m pwritev2` gather up to BATCHRECORDS records or BATCHBYTES bytes
+//    per system call. `-y` makes every system call durable (O_DSYNC, or
+//    RWF_DSYNC for `pwritev2`). Progress is reported every `-i SECONDS`
+//    (default 0.1) by a `progress_reporter` thread; `-T` prints the
+//    throughput-over-time series at the end.
+
+#define NPOOL 4096
+
+int main(int argc, char* argv[]) {
+    record_method method = record_writev;
+    size_t batch_records = 64, batch_bytes = 65536, nrecords = 1000000;
+    size_t minlen = 16, maxlen = 256;
+    bool dsync = false;
+    double interval = 0.1;
+    bool series = false;
+    int ch;
+    while ((ch = getopt(argc, argv, "m:n:B:r:l:L:yi:T")) != -1) {
+        if (ch == 'm' && strcmp(optarg, "write") == 0) {
+            method = record_write;
+        } else if (ch == 'm' && strcmp(optarg, "writev") == 0) {
+            method = record_writev;
+        } else if (ch == 'm' && strcmp(optarg, "pwritev2") == 0) {
+            method = record_pwritev2;
+        } else if (ch == 'n' && strisnumber(optarg)) {
+            batch_records = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'B' && strisnumber(optarg)) {
+            batch_bytes = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'r' && strisnumber(optarg)) {
+            nrecords = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'l' && strisnumber(optarg)) {
+            minlen = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'L' && strisnumber(optarg)) {
+            maxlen = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'y') {
+            dsync = true;
+        } else if (ch == 'i' && strtod(optarg, nullptr) > 0) {
+            interval = strtod(optarg, nullptr);
+        } else if (ch == 'T') {
+            series = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-m write|writev|pwritev2] [-n BATCHRECORDS] [-B BATCHBYTES] [-r NRECORDS] [-l MINLEN] [-L MAXLEN] [-y] [-i SECONDS] [-T]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (minlen == 0 || maxlen < minlen) {
+        fprintf(stderr, "%s: need 0 < MINLEN <= MAXLEN\n", argv[0]);
+        exit(1);
+    }
+
+    int oflags = dsync && method != record_pwritev2 ? O_DSYNC : 0;
+    int fd = STDOUT_FILENO;
+    if (isatty(fd)) {
+        fd = open(DATAFILE, O_WRONLY | O_CREAT | O_TRUNC | oflags, 0666);
+    } else if (oflags) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | oflags);
+    }
+    if (fd < 0) {
+        perror("open");
+        exit(1);
+    }
+
+    // generate a pool of records, each ending in a newline
+    size_t offsets[NPOOL + 1];
+    offsets[0] = 0;
+    for (int i = 0; i != NPOOL; ++i) {
+        offsets[i + 1] = offsets[i] + minlen + random() % (maxlen - minlen + 1);
+    }
+    char* pool = (char*) malloc(offsets[NPOOL]);
+    for (int i = 0; i != NPOOL; ++i) {
+        size_t len = offsets[i + 1] - offsets[i];
+        memset(&pool[offsets[i]], 'a' + i % 26, len - 1);
+        pool[offsets[i + 1] - 1] = '\n';
+    }
+
+    record_writer w(fd, method, batch_records, batch_bytes,
+                    dsync ? RWF_DSYNC : 0);
+    latency_histogram lat;
+    progress_reporter progress(interval, true);
+
+    size_t n = 0;
+    for (size_t r = 0; r != nrecords; ++r) {
+        int i = r % NPOOL;
+        size_t len = offsets[i + 1] - offsets[i];
+        uint64_t t0 = cycles();
+        w.append(&pool[offsets[i]], len);
+        lat.record(cycles_since(t0));
+        n += len;
+        progress.set(n, r + 1);
+    }
+
+    w.flush();
+    close(fd);
+    double elapsed = progress.stop();
+    report_records(n, nrecords, elapsed);
+    if (series) {
+        fprintf(stderr, "\n");
+        progress.print_series(stderr);
+    }
+    fprintf(stderr, "\nrecords: %zu syscalls   %g records/syscall   %g bytes/syscall\n",
+            w.nsyscalls(), nrecords / (double) w.nsyscalls(),
+            n / (double) w.nsyscalls());
+    report_latency(lat);
+    free(pool);
+}
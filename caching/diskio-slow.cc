@@ -1,34 +1,44 @@
-#define PRINT_FREQUENCY 128
-#include "iobench.hh"
+#include "diskio.hh"
 
-int main() {
-    int fd = STDOUT_FILENO;
-    if (isatty(fd)) {
-        fd = open(DATAFILE, O_WRONLY | O_CREAT | O_TRUNC | O_SYNC, 0666);
-    }
-    if (fd < 0) {
-        perror("open");
-        exit(1);
-    }
+int main(int argc, char* argv[]) {
+    diskio_options opt = parse_diskio_arguments(argc, argv, mode_syscall);
+    diskio_file f(opt, O_SYNC);
 
     size_t size = 5120000;
     const char* buf = "6";
-    double start = tstamp();
+    perf_counters* pc = opt.counters ? new perf_counters : nullptr;
+    if (pc) {
+        pc->start();
+    }
+    progress_reporter progress(opt.interval);
 
     size_t n = 0;
     while (n < size) {
-        ssize_t r = write(fd, buf, 1);
+        ssize_t r = f.write(buf, 1);
         if (r != 1) {
             perror("write");
             exit(1);
         }
         n += r;
-        if (n % PRINT_FREQUENCY == 0) {
-            report(n, tstamp() - start);
-        }
+        progress.set(n);
     }
 
-    close(fd);
-    report(n, tstamp() - start);
+    f.close();
+    if (pc) {
+        pc->stop();
+    }
+    double elapsed = progress.stop();
+    report(n, elapsed);
     fprintf(stderr, "\n");
+    if (opt.series) {
+        progress.print_series(stderr);
+    }
+    f.print_stats();
+    if (opt.latency) {
+        report_latency(f.lat);
+    }
+    if (pc) {
+        pc->print(stderr, n);
+        delete pc;
+    }
 }
@@ -0,0 +1,260 @@
+#ifndef DISKIO_HH
+#define DISKIO_HH
+#include "iobench.hh"
+#include "wcache.hh"
+#include "uring.hh"
+#include "directio.hh"
+#include "bufwriter.hh"
+#include "perfcounters.hh"
+#include "allowexec.hh"
+
+// diskio_options
+//    Command-line options shared by the `diskio-*` programs. The mode
+//    chooses how each application-level write reaches the file:
+//
+//    - `syscall`: one `write` system call per application write.
+//    - `stdio`: `fwrite` through a stdio `FILE*`. With `-b`, the stream's
+//      buffer is BLOCKSIZE bytes (`setvbuf`).
+//    - `unlocked`: like `stdio`, but with `fwrite_unlocked`, which skips
+//      the stream lock.
+//    - `buffered`: through a single-owner `bufwriter` with a BLOCKSIZE-byte
+//      buffer (default 64 KiB; see bufwriter.hh), which has no lock and
+//      inlines the common case.
+//    - `cache`: through a `wcache` (see wcache.hh).
+//    - `uring`: through a `uring_writer`, which keeps up to `depth`
+//      block-sized writes in flight (see uring.hh).
+//    - `direct`: through a `direct_writer`, which bypasses the page cache
+//      with O_DIRECT (see directio.hh).
+//
+//    `-e` counts hardware events over the write loop (see perfcounters.hh).
+//    A `progress_reporter` thread prints progress every `-i SECONDS`
+//    (default 0.1), so the write loop itself makes no extra system calls;
+//    `-T` prints the resulting throughput-over-time series at the end.
+//    `-L` times every write and prints a latency histogram; it is off by
+//    default because it reads the cycle counter twice per write.
+
+enum diskio_mode {
+    mode_syscall, mode_stdio, mode_unlocked, mode_buffered, mode_cache,
+    mode_uring, mode_direct
+};
+
+struct diskio_options {
+    diskio_mode mode;
+    size_t block_size = 0;      // stdio, bufwriter, cache slot, io_uring,
+                                // or O_DIRECT buffer size; 0 means default
+    size_t nslots = 1;          // # cache slots
+    size_t threshold = 1;       // flush after this many full slots
+    bool write_behind = false;  // flush on a background thread
+    unsigned depth = 8;         // io_uring queue depth
+    bool counters = false;      // count hardware events
+    double interval = 0.1;      // progress report interval in seconds
+    bool series = false;        // print throughput series at end
+    bool latency = false;       // record per-write latency
+};
+
+static inline diskio_options parse_diskio_arguments(int argc, char** argv,
+                                                    diskio_mode mode) {
+    diskio_options opt;
+    opt.mode = mode;
+    int ch;
+    while ((ch = getopt(argc, argv, "m:b:n:t:wq:ei:TL")) != -1) {
+        if (ch == 'm' && strcmp(optarg, "syscall") == 0) {
+            opt.mode = mode_syscall;
+        } else if (ch == 'm' && strcmp(optarg, "stdio") == 0) {
+            opt.mode = mode_stdio;
+        } else if (ch == 'm' && strcmp(optarg, "unlocked") == 0) {
+            opt.mode = mode_unlocked;
+        } else if (ch == 'm' && strcmp(optarg, "buffered") == 0) {
+            opt.mode = mode_buffered;
+        } else if (ch == 'm' && strcmp(optarg, "cache") == 0) {
+            opt.mode = mode_cache;
+        } else if (ch == 'm' && strcmp(optarg, "uring") == 0) {
+            opt.mode = mode_uring;
+        } else if (ch == 'm' && strcmp(optarg, "direct") == 0) {
+            opt.mode = mode_direct;
+        } else if (ch == 'b' && strisnumber(optarg)
+                   && strtol(optarg, nullptr, 0) > 0) {
+            opt.block_size = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'n' && strisnumber(optarg)) {
+            opt.nslots = strtoul(optarg, nullptr, 0);
+        } else if (ch == 't' && strisnumber(optarg)) {
+            opt.threshold = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'w') {
+            opt.write_behind = true;
+        } else if (ch == 'q' && strisnumber(optarg)) {
+            opt.depth = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'e') {
+            opt.counters = true;
+        } else if (ch == 'i' && strtod(optarg, nullptr) > 0) {
+            opt.interval = strtod(optarg, nullptr);
+        } else if (ch == 'T') {
+            opt.series = true;
+        } else if (ch == 'L') {
+            opt.latency = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-m syscall|stdio|unlocked|buffered|cache|uring|direct] [-b BLOCKSIZE] [-n SLOTS] [-t THRESHOLD] [-w] [-q DEPTH] [-e] [-i SECONDS] [-T] [-L]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (opt.nslots == 0 || opt.threshold == 0 || opt.depth == 0) {
+        fprintf(stderr, "%s: slots, threshold, and depth must be positive\n", argv[0]);
+        exit(1);
+    }
+    if (opt.mode == mode_buffered && opt.block_size == 0) {
+        opt.block_size = bufwriter::min_buffer_size;
+    } else if (opt.mode == mode_buffered
+               && (opt.block_size < bufwriter::min_buffer_size
+                   || opt.block_size > bufwriter::max_buffer_size)) {
+        fprintf(stderr, "%s: buffered mode needs a block size from %zu to %zu\n",
+                argv[0], bufwriter::min_buffer_size, bufwriter::max_buffer_size);
+        exit(1);
+    } else if (opt.block_size == 0 && opt.mode != mode_stdio
+               && opt.mode != mode_unlocked) {
+        opt.block_size = 4096;
+    }
+    return opt;
+}
+
+
+// diskio_file
+//    An output file written in one of the `diskio_mode`s. Writes to standard
+//    output unless it is a terminal, in which case writes to DATAFILE.
+
+struct diskio_file {
+    diskio_options opt;
+    int fd;
+    FILE* f = nullptr;
+    bufwriter* bw = nullptr;
+    wcache* wc = nullptr;
+    uring_writer* uw = nullptr;
+    direct_writer* dw = nullptr;
+    size_t nsyscalls = 0;       // statistics, set by `close()`
+    size_t nflushed = 0;
+    const char* method = nullptr;
+    latency_histogram lat;      // latency of `write` calls, if `opt.latency`
+
+    diskio_file(const diskio_options& opt_, int oflags)
+        : opt(opt_) {
+        this->fd = STDOUT_FILENO;
+        if (isatty(this->fd)) {
+            this->fd = open(DATAFILE, O_WRONLY | O_CREAT | O_TRUNC | oflags, 0666);
+        }
+        if (this->fd < 0) {
+            perror("open");
+            exit(1);
+        }
+        if (opt.mode == mode_stdio || opt.mode == mode_unlocked) {
+            this->f = fdopen(this->fd, "w");
+            if (!this->f) {
+                perror("fdopen");
+                exit(1);
+            }
+            if (opt.block_size != 0
+                && setvbuf(this->f, nullptr, _IOFBF, opt.block_size) != 0) {
+                perror("setvbuf");
+                exit(1);
+            }
+        } else if (opt.mode == mode_buffered) {
+            this->bw = new bufwriter(this->fd, opt.block_size);
+        } else if (opt.mode == mode_cache) {
+            this->wc = new wcache(this->fd, opt.block_size, opt.nslots,
+                                  opt.threshold, opt.write_behind);
+        } else if (opt.mode == mode_uring) {
+            this->uw = new uring_writer(this->fd, opt.block_size, opt.depth);
+        } else if (opt.mode == mode_direct) {
+            this->dw = new direct_writer(this->fd, opt.block_size);
+        }
+    }
+
+    // Write `sz` bytes from `buf`. With `opt.latency`, record the call's
+    // latency in `lat`.
+    ssize_t write(const char* buf, size_t sz) {
+        uint64_t t0 = this->opt.latency ? cycles() : 0;
+        ssize_t r;
+        if (this->opt.mode == mode_syscall) {
+            r = ::write(this->fd, buf, sz);
+        } else if (this->opt.mode == mode_stdio) {
+            r = fwrite(buf, 1, sz, this->f) == sz ? (ssize_t) sz : -1;
+        } else if (this->opt.mode == mode_unlocked) {
+            r = fwrite_unlocked(buf, 1, sz, this->f) == sz ? (ssize_t) sz : -1;
+        } else if (this->opt.mode == mode_buffered) {
+            r = this->bw->fwrite(buf, 1, sz) == sz ? (ssize_t) sz : -1;
+        } else if (this->opt.mode == mode_cache) {
+            r = this->wc->write(buf, sz);
+        } else if (this->opt.mode == mode_uring) {
+            r = this->uw->write(buf, sz);
+        } else {
+            r = this->dw->write(buf, sz);
+        }
+        if (this->opt.latency) {
+            this->lat.record(cycles_since(t0));
+        }
+        return r;
+    }
+
+    // Flush any buffered data and close the file.
+    void close() {
+        if (this->f) {
+            fclose(this->f);
+            return;
+        }
+        if (this->bw) {
+            if (this->bw->flush() != 0) {
+                fprintf(stderr, "write: %s\n", strerror(this->bw->error()));
+                exit(1);
+            }
+            this->nsyscalls = this->bw->nsyscalls();
+            this->nflushed = this->bw->nwritten();
+            delete this->bw;
+            this->bw = nullptr;
+        }
+        if (this->wc) {
+            this->wc->flush();
+            this->nsyscalls = this->wc->nsyscalls();
+            this->nflushed = this->wc->nflushed();
+            delete this->wc;
+            this->wc = nullptr;
+        }
+        if (this->uw) {
+            this->uw->flush();
+            this->nsyscalls = this->uw->nsyscalls();
+            this->nflushed = this->uw->nwritten();
+            this->method = this->uw->method();
+            this->opt.depth = this->uw->depth();
+            delete this->uw;
+            this->uw = nullptr;
+        }
+        if (this->dw) {
+            this->dw->flush();
+            this->nsyscalls = this->dw->nsyscalls();
+            this->nflushed = this->dw->nwritten();
+            this->method = this->dw->method();
+            delete this->dw;
+            this->dw = nullptr;
+        }
+        ::close(this->fd);
+    }
+
+    // Print statistics to stderr (buffered, cache, uring, and direct modes
+    // only).
+    void print_stats() const {
+        if (this->opt.mode == mode_buffered && this->nsyscalls > 0) {
+            fprintf(stderr, "buffered: %zu-byte buffer   %zu syscalls   %g bytes/syscall\n",
+                    this->opt.block_size, this->nsyscalls,
+                    this->nflushed / (double) this->nsyscalls);
+        } else if (this->opt.mode == mode_cache && this->nsyscalls > 0) {
+            fprintf(stderr, "cache: %zu syscalls   %g bytes/syscall\n",
+                    this->nsyscalls, this->nflushed / (double) this->nsyscalls);
+        } else if (this->opt.mode == mode_uring && this->nsyscalls > 0) {
+            fprintf(stderr, "uring: %s   depth %u   %zu syscalls   %g bytes/syscall\n",
+                    this->method, this->opt.depth, this->nsyscalls,
+                    this->nflushed / (double) this->nsyscalls);
+        } else if (this->opt.mode == mode_direct && this->nsyscalls > 0) {
+            fprintf(stderr, "direct: %s   %zu syscalls   %g bytes/syscall\n",
+                    this->method, this->nsyscalls,
+                    this->nflushed / (double) this->nsyscalls);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef FEISTEL_HH
+#define FEISTEL_HH
+#include <cstdint>
+#include <utility>
+
+// feistel_permutation
+//    A pseudorandom bijection on [0, n), computed one index at a time in
+//    constant memory, so a random visiting order of any size needs no
+//    stored permutation array.
+//
+//    The core is a four-round Feistel network on the smallest number of
+//    bits that covers `n`, split into two halves whose widths differ by at
+//    most one; each round mixes one half into the other with a keyed
+//    multiply-shift hash. A Feistel network is a permutation for any round
+//    function. Values that land outside [0, n) are fed through the network
+//    again ("cycle walking") until one lands inside, which keeps the map a
+//    bijection on [0, n) and takes fewer than 2 passes on average.
+
+struct feistel_permutation {
+    feistel_permutation(uint64_t n, uint64_t seed)
+        : n_(n) {
+        int bits = 2;
+        while (bits < 64 && (uint64_t(1) << bits) < n) {
+            ++bits;
+        }
+        this->lbits_ = bits / 2;
+        this->rbits_ = bits - this->lbits_;
+        for (auto& k : this->keys_) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            k = mix(seed);
+        }
+    }
+
+    uint64_t size() const {
+        return this->n_;
+    }
+
+    // Return the image of `x`, which must be less than `size()`.
+    uint64_t operator()(uint64_t x) const {
+        do {
+            x = this->encrypt(x);
+        } while (x >= this->n_);
+        return x;
+    }
+
+  private:
+    uint64_t n_;
+    int lbits_;                 // width of left half
+    int rbits_;                 // width of right half
+    uint64_t keys_[4];
+
+    // splitmix64's finalizer, for deriving round keys
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // One pass through the network. Each round replaces (l, r) with
+    // (r, l ^ F(r)), so the halves trade widths; after an even number of
+    // rounds they are back where they started.
+    uint64_t encrypt(uint64_t x) const {
+        int lb = this->lbits_, rb = this->rbits_;
+        uint64_t l = x >> rb, r = x & ((uint64_t(1) << rb) - 1);
+        for (uint64_t k : this->keys_) {
+            uint64_t f = ((r ^ k) * 0x9E3779B97F4A7C15ULL) >> (64 - lb);
+            uint64_t t = l ^ f;
+            l = r;
+            r = t;
+            std::swap(lb, rb);
+        }
+        return (l << rb) | r;
+    }
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include "hugealloc.hh"
+#include "mmapread.hh"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#define MPOL_INTERLEAVE 3
+#endif
+#ifndef MPOL_F_NODE
+#define MPOL_F_NODE (1 << 0)
+#define MPOL_F_ADDR (1 << 1)
+#endif
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+static const char* const huge_names[] = {"4K pages", "THP", "hugetlb"};
+
+
+// Map `size` bytes aligned to a huge page boundary.
+static void* map_aligned(size_t size) {
+    size_t len = size + HUGE_PAGE_SIZE;
+    void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    uintptr_t start = (uintptr_t) p;
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (aligned > start) {
+        munmap(p, aligned - start);
+    }
+    if (aligned + size < start + len) {
+        munmap((void*) (aligned + size), start + len - aligned - size);
+    }
+    return (void*) aligned;
+}
+
+// Return a bitmask of online NUMA nodes (node 0 if unknown).
+static unsigned long online_nodes() {
+    unsigned long mask = 0;
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    int lo, hi;
+    char sep;
+    while (f && fscanf(f, "%d", &lo) == 1) {
+        hi = lo;
+        if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+            if (fscanf(f, "%d", &hi) != 1) {
+                break;
+            }
+            if (fscanf(f, "%c", &sep) != 1) {
+                sep = 0;
+            }
+        }
+        for (int n = lo; n <= hi && n < 64; ++n) {
+            mask |= 1UL << n;
+        }
+        if (sep != ',') {
+            break;
+        }
+    }
+    if (f) {
+        fclose(f);
+    }
+    return mask ? mask : 1;
+}
+
+big_array big_alloc(size_t size, const alloc_options& opt) {
+    big_array a;
+    a.size = size;
+    a.requested = opt;
+    size = std::max(size, (size_t) 1);
+
+    if (opt.huge == huge_none && opt.numa == numa_default) {
+        a.ptr = ::operator new(size);
+        return a;
+    }
+
+    size_t mapsize = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (opt.huge == huge_hugetlb) {
+        void* p = mmap(nullptr, mapsize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            a.ptr = p;
+            a.huge = huge_hugetlb;
+        } else {
+            a.huge_errno = errno;
+        }
+    }
+    if (!a.ptr) {
+        a.ptr = map_aligned(mapsize);
+        if (!a.ptr) {
+            perror("mmap");
+            exit(1);
+        }
+        a.huge = huge_none;
+#ifdef MADV_HUGEPAGE
+        if (opt.huge != huge_none
+            && madvise(a.ptr, mapsize, MADV_HUGEPAGE) == 0) {
+            a.huge = huge_thp;
+        }
+#endif
+    }
+    a.mapsize = mapsize;
+
+    if (opt.numa != numa_default) {
+        unsigned long mask = opt.numa == numa_bind
+            ? (opt.node < 64 ? 1UL << opt.node : 0) : online_nodes();
+        int mode = opt.numa == numa_bind ? MPOL_BIND : MPOL_INTERLEAVE;
+        if (syscall(__NR_mbind, a.ptr, mapsize, mode, &mask,
+                    sizeof(mask) * 8, 0) != 0) {
+            a.numa_errno = errno;
+        }
+    }
+    return a;
+}
+
+void big_free(big_array& a) {
+    if (a.mapsize) {
+        munmap(a.ptr, a.mapsize);
+    } else {
+        ::operator delete(a.ptr);
+    }
+    a.ptr = nullptr;
+}
+
+double big_huge_percent(const big_array& a) {
+    long kb = mapping_huge_kb(a.ptr);
+    if (kb < 0 || a.size == 0) {
+        return -1;
+    }
+    return std::min(100.0, 100.0 * kb * 1024 / a.size);
+}
+
+void big_report(const big_array& a, const char* name, FILE* out) {
+    fprintf(out, "memory: %s: %zu kB, %s", name, a.size >> 10,
+            huge_names[a.huge]);
+    if (a.requested.huge != a.huge) {
+        fprintf(out, " (%s requested", huge_names[a.requested.huge]);
+        if (a.huge_errno) {
+            fprintf(out, "; MAP_HUGETLB: %s", strerror(a.huge_errno));
+        }
+        fprintf(out, ")");
+    }
+    long kb = mapping_huge_kb(a.ptr);
+    if (kb >= 0) {
+        fprintf(out, ", %ld kB in huge pages (%.0f%%)", kb,
+                big_huge_percent(a));
+    }
+
+    int node = -1;
+    if (syscall(__NR_get_mempolicy, &node, nullptr, 0, a.ptr,
+                MPOL_F_NODE | MPOL_F_ADDR) == 0) {
+        fprintf(out, ", first page on node %d", node);
+    }
+    if (a.requested.numa == numa_bind) {
+        fprintf(out, " (bound to node %d", a.requested.node);
+    } else if (a.requested.numa == numa_interleave) {
+        fprintf(out, " (interleaved");
+    }
+    if (a.requested.numa != numa_default) {
+        if (a.numa_errno) {
+            fprintf(out, " failed: %s", strerror(a.numa_errno));
+        }
+        fprintf(out, ")");
+    }
+    fprintf(out, "\n");
+}
+
+bool parse_huge_mode(const char* arg, alloc_options& opt) {
+    if (strcmp(arg, "none") == 0) {
+        opt.huge = huge_none;
+    } else if (strcmp(arg, "thp") == 0) {
+        opt.huge = huge_thp;
+    } else if (strcmp(arg, "hugetlb") == 0) {
+        opt.huge = huge_hugetlb;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_numa_mode(const char* arg, alloc_options& opt) {
+    char* end;
+    if (strcmp(arg, "interleave") == 0) {
+        opt.numa = numa_interleave;
+    } else if (isdigit((unsigned char) arg[0])
+               && (opt.node = strtol(arg, &end, 10), *end == 0)) {
+        opt.numa = numa_bind;
+    } else {
+        return false;
+    }
+    return true;
+}
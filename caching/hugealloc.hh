@@ -0,0 +1,67 @@
+#ifndef HUGEALLOC_HH
+#define HUGEALLOC_HH
+#include <cstdio>
+#include <cstddef>
+
+// big_alloc
+//    Allocate large benchmark arrays with a chosen page size and NUMA
+//    placement, so TLB effects can be measured separately from cache
+//    effects.
+//
+//    - `huge_none`: ordinary `operator new` memory (4 KiB pages unless the
+//      system's THP setting is `always`).
+//    - `huge_thp`: a 2 MiB-aligned anonymous mapping advised
+//      MADV_HUGEPAGE, so the kernel can back it with transparent huge pages.
+//    - `huge_hugetlb`: a MAP_HUGETLB mapping from the reserved huge page
+//      pool (`vm.nr_hugepages`). If the pool is too small, falls back to
+//      THP.
+//
+//    `numa` binds the pages to node `node` or interleaves them across all
+//    online nodes with `mbind`. Kernels and machines without NUMA support
+//    just ignore the request.
+//
+//    Requests are best-effort; `big_report` says what was actually
+//    obtained. Call it after the array has been written, since pages are
+//    allocated on first touch.
+
+enum huge_mode {
+    huge_none, huge_thp, huge_hugetlb
+};
+
+enum numa_mode {
+    numa_default, numa_bind, numa_interleave
+};
+
+struct alloc_options {
+    huge_mode huge = huge_none;
+    numa_mode numa = numa_default;
+    int node = 0;               // node for `numa_bind`
+};
+
+struct big_array {
+    void* ptr = nullptr;
+    size_t size = 0;            // requested size
+    size_t mapsize = 0;         // mapping size, or 0 if from `operator new`
+    alloc_options requested;
+    huge_mode huge = huge_none; // page size mode actually used
+    int numa_errno = 0;         // error from `mbind`, if any
+    int huge_errno = 0;         // error from MAP_HUGETLB, if any
+};
+
+big_array big_alloc(size_t size, const alloc_options& opt);
+void big_free(big_array& a);
+
+// Print a line to `out` describing what backs `a` (named `name`): the
+// page size mode, how much is in huge pages, and the NUMA node holding its
+// first page.
+void big_report(const big_array& a, const char* name, FILE* out);
+// Return the percentage of `a` currently backed by huge pages, or -1 if
+// unknown.
+double big_huge_percent(const big_array& a);
+
+// Parse `-H` and `-N` option arguments into `opt`. Returns false if `arg`
+// is invalid.
+bool parse_huge_mode(const char* arg, alloc_options& opt);
+bool parse_numa_mode(const char* arg, alloc_options& opt);
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef INTLIST_HH
+#define INTLIST_HH
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <list>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+
+// pool_allocator<T>
+//    An allocator for node-based containers like `std::list`. Single
+//    objects are carved in order from 64 KiB slabs, and freed objects go on
+//    a free list for reuse, so nodes allocated one after another sit next
+//    to each other in memory (unlike `malloc`, which interleaves them with
+//    other allocations and its own headers). Each object type has one pool
+//    shared by all containers; the pool is not thread-safe. Slabs are never
+//    returned to the system.
+
+template <typename T>
+struct node_pool {
+    union slot {
+        slot* next;
+        alignas(T) unsigned char data[sizeof(T)];
+    };
+    static constexpr size_t slab_size = 65536;
+
+    slot* free_ = nullptr;
+    slot* pos_ = nullptr;       // next unused slot in current slab
+    slot* end_ = nullptr;
+
+    static node_pool& get() {
+        static node_pool pool;
+        return pool;
+    }
+
+    void* allocate() {
+        if (this->free_) {
+            slot* s = this->free_;
+            this->free_ = s->next;
+            return s;
+        }
+        if (this->pos_ == this->end_) {
+            size_t n = std::max(slab_size / sizeof(slot), (size_t) 1);
+            this->pos_ = (slot*) ::operator new(n * sizeof(slot));
+            this->end_ = this->pos_ + n;
+        }
+        return this->pos_++;
+    }
+
+    void deallocate(void* p) {
+        slot* s = (slot*) p;
+        s->next = this->free_;
+        this->free_ = s;
+    }
+};
+
+template <typename T>
+struct pool_allocator {
+    using value_type = T;
+
+    pool_allocator() = default;
+    template <typename U>
+    pool_allocator(const pool_allocator<U>&) {
+    }
+
+    T* allocate(size_t n) {
+        if (n == 1) {
+            return (T*) node_pool<T>::get().allocate();
+        }
+        return (T*) ::operator new(n * sizeof(T));
+    }
+    void deallocate(T* p, size_t n) {
+        if (n == 1) {
+            node_pool<T>::get().deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) {
+    return true;
+}
+template <typename T, typename U>
+inline bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) {
+    return false;
+}
+
+// pool_list
+//    A `std::list<int>` whose nodes come from a `node_pool`.
+using pool_list = std::list<int, pool_allocator<int>>;
+
+
+// chunked_list
+//    An unrolled linked list of ints: a singly-linked list of 256-byte
+//    chunks, each holding up to `chunk_capacity` consecutive elements.
+//    Traversal follows one pointer per chunk rather than one per element,
+//    and the elements within a chunk are contiguous, so the hardware
+//    prefetcher and SIMD loops can work on them.
+//
+//    Supports the `std::list` operations the qslib helpers use:
+//    `push_back`, forward iteration, `size`, `empty`, `clear`, and
+//    `splice` of a whole list onto the end (which moves chunks without
+//    copying elements). `for_each_chunk` visits the elements one
+//    contiguous array at a time.
+
+struct chunked_list {
+    struct chunk {
+        chunk* next;
+        int n;
+        int v[(256 - sizeof(chunk*) - sizeof(int)) / sizeof(int)];
+    };
+    static constexpr int chunk_capacity = sizeof(chunk::v) / sizeof(int);
+
+    struct const_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        const chunk* c;
+        int i;
+
+        const int& operator*() const {
+            return this->c->v[this->i];
+        }
+        const_iterator& operator++() {
+            if (++this->i == this->c->n) {
+                this->c = this->c->next;
+                this->i = 0;
+            }
+            return *this;
+        }
+        bool operator==(const const_iterator& x) const {
+            return this->c == x.c && this->i == x.i;
+        }
+        bool operator!=(const const_iterator& x) const {
+            return !(*this == x);
+        }
+    };
+
+    chunked_list() = default;
+    chunked_list(const chunked_list& x) {
+        this->append(x);
+    }
+    chunked_list(chunked_list&& x) noexcept
+        : head_(x.head_), tail_(x.tail_), size_(x.size_) {
+        x.head_ = x.tail_ = nullptr;
+        x.size_ = 0;
+    }
+    chunked_list& operator=(chunked_list x) {
+        std::swap(this->head_, x.head_);
+        std::swap(this->tail_, x.tail_);
+        std::swap(this->size_, x.size_);
+        return *this;
+    }
+    ~chunked_list() {
+        this->clear();
+    }
+
+    size_t size() const {
+        return this->size_;
+    }
+    bool empty() const {
+        return this->size_ == 0;
+    }
+    const_iterator begin() const {
+        return {this->head_, 0};
+    }
+    const_iterator end() const {
+        return {nullptr, 0};
+    }
+
+    void push_back(int x) {
+        if (!this->tail_ || this->tail_->n == chunk_capacity) {
+            this->add_chunk();
+        }
+        this->tail_->v[this->tail_->n] = x;
+        ++this->tail_->n;
+        ++this->size_;
+    }
+
+    // Copy all of `x`'s elements onto the end, a chunk at a time.
+    void append(const chunked_list& x) {
+        for (const chunk* c = x.head_; c; c = c->next) {
+            int pos = 0;
+            while (pos < c->n) {
+                if (!this->tail_ || this->tail_->n == chunk_capacity) {
+                    this->add_chunk();
+                }
+                int m = std::min(c->n - pos, chunk_capacity - this->tail_->n);
+                memcpy(&this->tail_->v[this->tail_->n], &c->v[pos],
+                       m * sizeof(int));
+                this->tail_->n += m;
+                pos += m;
+            }
+        }
+        this->size_ += x.size_;
+    }
+
+    // Move all of `x`'s chunks onto the end, leaving `x` empty.
+    void splice(chunked_list& x) {
+        if (x.head_) {
+            (this->tail_ ? this->tail_->next : this->head_) = x.head_;
+            this->tail_ = x.tail_;
+            this->size_ += x.size_;
+            x.head_ = x.tail_ = nullptr;
+            x.size_ = 0;
+        }
+    }
+
+    void clear() {
+        while (this->head_) {
+            chunk* c = this->head_;
+            this->head_ = c->next;
+            delete c;
+        }
+        this->tail_ = nullptr;
+        this->size_ = 0;
+    }
+
+    // Call `f(array, n)` for each chunk's elements in order.
+    template <typename F>
+    void for_each_chunk(F f) const {
+        for (const chunk* c = this->head_; c; c = c->next) {
+            f((const int*) c->v, c->n);
+        }
+    }
+
+  private:
+    chunk* head_ = nullptr;
+    chunk* tail_ = nullptr;
+    size_t size_ = 0;
+
+    void add_chunk() {
+        chunk* c = new chunk;
+        c->next = nullptr;
+        c->n = 0;
+        (this->tail_ ? this->tail_->next : this->head_) = c;
+        this->tail_ = c;
+    }
+};
+
+#endif
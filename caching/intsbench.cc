@@ -0,0 +1,85 @@
+#include "qslib.hh"
+#include "allowexec.hh"
+
+// Usage: ./intsbench [-i REPEATS] [SIZE]
+//    Compare the scalar and SIMD versions of `ints_checksum` and
+//    `ints_sorted` on an array of SIZE integers (default 2^26, 256 MiB),
+//    printing GB/s for each instruction set the CPU supports. The array is
+//    sorted, so `ints_sorted` must scan all of it. Every kernel's results
+//    are checked against the scalar versions first.
+
+static const ints_isa isas[] = {isa_scalar, isa_sse2, isa_avx2, isa_avx512};
+
+// Check that every kernel agrees with the scalar one on small arrays
+// (exercising the vector tails) and on an array with one inversion.
+static void check_kernels(int* array, int n) {
+    for (int m = 0; m <= 200 && m <= n; ++m) {
+        for (auto isa : isas) {
+            if (ints_isa_supported(isa)) {
+                assert(ints_checksum_isa(isa, array, m)
+                       == ints_checksum_isa(isa_scalar, array, m));
+                assert(ints_sorted_isa(isa, array, m));
+            }
+        }
+    }
+    for (int pos : {1, 17, 63, 64, 65, n / 2, n - 1}) {
+        if (pos <= 0 || pos >= n) {
+            continue;
+        }
+        std::swap(array[pos - 1], array[pos]);
+        for (auto isa : isas) {
+            if (ints_isa_supported(isa)) {
+                assert(!ints_sorted_isa(isa, array, n));
+            }
+        }
+        std::swap(array[pos - 1], array[pos]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int n = 1 << 26;
+    unsigned repeats = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc
+            && strisnumber(argv[i + 1])) {
+            repeats = strtoul(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strisnumber(argv[i]) && strtol(argv[i], NULL, 0) > 0) {
+            n = strtol(argv[i], NULL, 0);
+        } else {
+            fprintf(stderr, "Usage: %s [-i REPEATS] [SIZE]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    int* array = new int[n];
+    initialize_up(array, n);
+    check_kernels(array, n);
+    unsigned expected = ints_checksum_isa(isa_scalar, array, n);
+    double gb = (double) n * sizeof(int) * repeats / 1e9;
+
+    printf("%d integers, %u repeats\n", n, repeats);
+    printf("%-8s %14s %14s\n", "kernel", "checksum GB/s", "sorted GB/s");
+    for (auto isa : isas) {
+        if (!ints_isa_supported(isa)) {
+            printf("%-8s %14s %14s\n", ints_isa_name(isa), "-", "-");
+            continue;
+        }
+        double start = tstamp();
+        for (unsigned r = 0; r != repeats; ++r) {
+            unsigned sum = ints_checksum_isa(isa, array, n);
+            assert(sum == expected);
+        }
+        double checksum_time = tstamp() - start;
+
+        start = tstamp();
+        for (unsigned r = 0; r != repeats; ++r) {
+            bool sorted = ints_sorted_isa(isa, array, n);
+            assert(sorted);
+        }
+        double sorted_time = tstamp() - start;
+        printf("%-8s %14.2f %14.2f\n", ints_isa_name(isa),
+               gb / checksum_time, gb / sorted_time);
+    }
+    delete[] array;
+}
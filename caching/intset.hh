@@ -0,0 +1,421 @@
+#ifndef INTSET_HH
+#define INTSET_HH
+#include <cstddef>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+// btree_ints
+//    A sorted multiset of integers stored in a B+ tree. Every value lives
+//    in a leaf of up to `leaf_capacity` sorted integers (256 bytes, four
+//    cache lines), and the leaves are linked in order. Inner nodes hold up
+//    to `inner_capacity` children and the separator keys between them.
+//    Inserting searches O(log n) small sorted arrays and moves at most one
+//    leaf's worth of integers, instead of half the container (`std::vector`)
+//    or chasing n/2 pointers (`std::list`).
+
+struct btree_ints {
+    static constexpr int leaf_capacity = 64;
+    static constexpr int inner_capacity = 32;
+
+    struct node {
+        bool leaf;
+        int n;                  // # keys (leaf) or # children (inner)
+    };
+    struct leaf_node : node {
+        int keys[leaf_capacity + 1];    // one extra slot before a split
+        leaf_node* next;
+    };
+    struct inner_node : node {
+        int keys[inner_capacity];       // keys[i] separates child[i], child[i+1]
+        node* child[inner_capacity + 1];
+    };
+
+    btree_ints() = default;
+    btree_ints(const btree_ints&) = delete;
+    btree_ints& operator=(const btree_ints&) = delete;
+    ~btree_ints() {
+        if (this->root_) {
+            destroy(this->root_);
+        }
+    }
+
+    size_t size() const {
+        return this->size_;
+    }
+
+    // Insert `v` after any equal values.
+    void insert(int v) {
+        if (!this->root_) {
+            this->first_ = new_leaf();
+            this->root_ = this->first_;
+        }
+        int sep;
+        node* split = insert(this->root_, v, sep);
+        if (split) {
+            inner_node* r = new inner_node;
+            r->leaf = false;
+            r->n = 2;
+            r->keys[0] = sep;
+            r->child[0] = this->root_;
+            r->child[1] = split;
+            this->root_ = r;
+        }
+        ++this->size_;
+    }
+
+    // Call `f(a, n)` for each leaf's sorted array of `n` integers, in order.
+    template <typename F>
+    void for_each_chunk(F f) const {
+        for (leaf_node* l = this->first_; l; l = l->next) {
+            if (l->n > 0) {
+                f(l->keys, l->n);
+            }
+        }
+    }
+
+    struct const_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        const leaf_node* l;
+        int i;
+
+        const int& operator*() const {
+            return this->l->keys[this->i];
+        }
+        const_iterator& operator++() {
+            if (++this->i == this->l->n) {
+                this->l = this->l->next;
+                this->i = 0;
+            }
+            return *this;
+        }
+        bool operator==(const const_iterator& x) const {
+            return this->l == x.l && this->i == x.i;
+        }
+        bool operator!=(const const_iterator& x) const {
+            return !(*this == x);
+        }
+    };
+    const_iterator begin() const {
+        return {this->size_ ? this->first_ : nullptr, 0};
+    }
+    const_iterator end() const {
+        return {nullptr, 0};
+    }
+
+  private:
+    node* root_ = nullptr;
+    leaf_node* first_ = nullptr;
+    size_t size_ = 0;
+
+    static leaf_node* new_leaf() {
+        leaf_node* l = new leaf_node;
+        l->leaf = true;
+        l->n = 0;
+        l->next = nullptr;
+        return l;
+    }
+
+    // Insert `v` into the subtree `x`. If `x` splits, return the new right
+    // sibling and set `sep` to the smallest key it may hold.
+    static node* insert(node* x, int v, int& sep) {
+        if (x->leaf) {
+            leaf_node* l = (leaf_node*) x;
+            int i = std::upper_bound(l->keys, l->keys + l->n, v) - l->keys;
+            memmove(&l->keys[i + 1], &l->keys[i], (l->n - i) * sizeof(int));
+            l->keys[i] = v;
+            if (++l->n <= leaf_capacity) {
+                return nullptr;
+            }
+            leaf_node* r = new_leaf();
+            int h = l->n / 2;
+            r->n = l->n - h;
+            memcpy(r->keys, &l->keys[h], r->n * sizeof(int));
+            l->n = h;
+            r->next = l->next;
+            l->next = r;
+            sep = r->keys[0];
+            return r;
+        }
+
+        inner_node* in = (inner_node*) x;
+        int i = std::upper_bound(in->keys, in->keys + in->n - 1, v) - in->keys;
+        int csep;
+        node* c = insert(in->child[i], v, csep);
+        if (!c) {
+            return nullptr;
+        }
+        memmove(&in->keys[i + 1], &in->keys[i], (in->n - 1 - i) * sizeof(int));
+        memmove(&in->child[i + 2], &in->child[i + 1],
+                (in->n - 1 - i) * sizeof(node*));
+        in->keys[i] = csep;
+        in->child[i + 1] = c;
+        if (++in->n <= inner_capacity) {
+            return nullptr;
+        }
+        inner_node* r = new inner_node;
+        r->leaf = false;
+        int h = in->n / 2;
+        r->n = in->n - h;
+        memcpy(r->keys, &in->keys[h], (r->n - 1) * sizeof(int));
+        memcpy(r->child, &in->child[h], r->n * sizeof(node*));
+        sep = in->keys[h - 1];
+        in->n = h;
+        return r;
+    }
+
+    static void destroy(node* x) {
+        if (x->leaf) {
+            delete (leaf_node*) x;
+        } else {
+            inner_node* in = (inner_node*) x;
+            for (int i = 0; i != in->n; ++i) {
+                destroy(in->child[i]);
+            }
+            delete in;
+        }
+    }
+};
+
+
+// pma_ints
+//    A sorted multiset of integers stored in a packed-memory array: one
+//    sorted array with gaps spread through it. An insert shifts integers
+//    only as far as the nearest gap in its segment (about log n slots).
+//    When a segment fills, the smallest enclosing window whose density is
+//    under its threshold (100% for a segment, falling to 75% for the whole
+//    array) is respread evenly; when the whole array is too dense, its
+//    capacity doubles. Traversal is a sequential scan, like `std::vector`.
+//
+//    Each gap holds a copy of the nearest value to its left (or INT_MIN),
+//    so the slots stay nondecreasing and a plain binary search finds the
+//    insert position.
+
+struct pma_ints {
+    pma_ints() {
+        this->resize(16);
+    }
+
+    size_t size() const {
+        return this->size_;
+    }
+    size_t capacity() const {
+        return this->slots_.size();
+    }
+
+    // Insert `v` after any equal values.
+    void insert(int v) {
+        while (true) {
+            size_t cap = this->capacity();
+            // first slot greater than `v` (always occupied, or `cap`)
+            size_t p = std::upper_bound(this->slots_.begin(),
+                                        this->slots_.end(), v)
+                - this->slots_.begin();
+            size_t target = p ? p - 1 : 0;
+
+            // find the smallest window around `target` with room
+            size_t w = this->segment_;
+            int level = 0;
+            size_t lo = target & ~(w - 1);
+            while (this->count(lo, lo + w) + 1 > this->threshold(w, level)) {
+                if (w == cap) {
+                    break;
+                }
+                w *= 2;
+                ++level;
+                lo = target & ~(w - 1);
+            }
+            if (this->count(lo, lo + w) + 1 > this->threshold(w, level)) {
+                this->resize(cap * 2);
+                continue;
+            }
+
+            if (level == 0) {
+                this->insert_in_segment(lo, lo + w, p, v);
+            } else {
+                this->respread(lo, lo + w, &v);
+            }
+            ++this->size_;
+            return;
+        }
+    }
+
+    // Call `f(a, n)` for each run of `n` adjacent occupied slots, in order.
+    template <typename F>
+    void for_each_chunk(F f) const {
+        size_t cap = this->capacity(), i = 0;
+        while (i != cap) {
+            while (i != cap && !this->used_[i]) {
+                ++i;
+            }
+            size_t j = i;
+            while (j != cap && this->used_[j]) {
+                ++j;
+            }
+            if (j != i) {
+                f(&this->slots_[i], (int) (j - i));
+            }
+            i = j;
+        }
+    }
+
+    struct const_iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        const pma_ints* a;
+        size_t i;
+
+        const int& operator*() const {
+            return this->a->slots_[this->i];
+        }
+        const_iterator& operator++() {
+            this->i = this->a->next_used(this->i + 1);
+            return *this;
+        }
+        bool operator==(const const_iterator& x) const {
+            return this->i == x.i;
+        }
+        bool operator!=(const const_iterator& x) const {
+            return this->i != x.i;
+        }
+    };
+    const_iterator begin() const {
+        return {this, this->next_used(0)};
+    }
+    const_iterator end() const {
+        return {this, this->capacity()};
+    }
+
+  private:
+    std::vector<int> slots_;
+    std::vector<unsigned char> used_;
+    size_t segment_;            // slots per segment (a power of 2)
+    int levels_;                // log2(capacity / segment)
+    size_t size_ = 0;
+
+    size_t next_used(size_t i) const {
+        while (i != this->capacity() && !this->used_[i]) {
+            ++i;
+        }
+        return i;
+    }
+
+    size_t count(size_t lo, size_t hi) const {
+        size_t n = 0;
+        for (size_t i = lo; i != hi; ++i) {
+            n += this->used_[i];
+        }
+        return n;
+    }
+
+    // Maximum number of integers a window of `w` slots at `level` (0 for a
+    // segment, `levels_` for the whole array) may hold.
+    double threshold(size_t w, int level) const {
+        double density = 1.0;
+        if (this->levels_ > 0) {
+            density -= 0.25 * level / this->levels_;
+        }
+        return density * w;
+    }
+
+    // Insert `v` before slot `p` in the segment [lo, hi), which has a gap,
+    // by shifting the occupied slots between `p` and the nearest gap.
+    void insert_in_segment(size_t lo, size_t hi, size_t p, int v) {
+        size_t left = p, right = p;
+        while (left > lo && this->used_[left - 1]) {
+            --left;
+        }
+        while (right < hi && this->used_[right]) {
+            ++right;
+        }
+        int* s = this->slots_.data();
+        if (left > lo && (right == hi || p - left <= right - p)) {
+            // gap at `left - 1`: shift [left, p) down one slot
+            size_t g = left - 1;
+            memmove(&s[g], &s[g + 1], (p - 1 - g) * sizeof(int));
+            s[p - 1] = v;
+            this->used_[g] = 1;
+        } else {
+            // gap at `right`: shift [p, right) up one slot
+            memmove(&s[p + 1], &s[p], (right - p) * sizeof(int));
+            s[p] = v;
+            this->used_[right] = 1;
+        }
+    }
+
+    // Spread the integers in [lo, hi), plus `*extra` if nonnull, evenly
+    // across [lo, hi).
+    void respread(size_t lo, size_t hi, const int* extra) {
+        std::vector<int> x;
+        x.reserve(hi - lo + 1);
+        for (size_t i = lo; i != hi; ++i) {
+            if (this->used_[i]) {
+                x.push_back(this->slots_[i]);
+            }
+        }
+        if (extra) {
+            x.insert(std::upper_bound(x.begin(), x.end(), *extra), *extra);
+        }
+        this->spread(lo, hi, x.data(), x.size());
+    }
+
+    // Write `x[0..n)` evenly across [lo, hi), filling gaps.
+    void spread(size_t lo, size_t hi, const int* x, size_t n) {
+        int last = lo ? this->slots_[lo - 1] : INT_MIN;
+        size_t w = hi - lo, j = 0;
+        for (size_t i = 0; i != w; ++i) {
+            if (j != n && j * w / n == i) {
+                last = this->slots_[lo + i] = x[j];
+                this->used_[lo + i] = 1;
+                ++j;
+            } else {
+                this->slots_[lo + i] = last;
+                this->used_[lo + i] = 0;
+            }
+        }
+        // gaps just past the window copy its (possibly new) last value
+        for (size_t i = hi; i != this->capacity() && !this->used_[i]; ++i) {
+            this->slots_[i] = last;
+        }
+    }
+
+    void resize(size_t cap) {
+        std::vector<int> x;
+        x.reserve(this->size_);
+        for (size_t i = 0; i != this->slots_.size(); ++i) {
+            if (this->used_[i]) {
+                x.push_back(this->slots_[i]);
+            }
+        }
+        this->slots_.assign(cap, INT_MIN);
+        this->used_.assign(cap, 0);
+        // segments of about log2(cap) slots, rounded up to a power of 2
+        int lg = 0;
+        while ((size_t(1) << lg) < cap) {
+            ++lg;
+        }
+        this->segment_ = 8;
+        while (this->segment_ < (size_t) lg && this->segment_ < cap) {
+            this->segment_ *= 2;
+        }
+        this->segment_ = std::min(this->segment_, cap);
+        this->levels_ = 0;
+        while ((this->segment_ << this->levels_) < cap) {
+            ++this->levels_;
+        }
+        this->spread(0, cap, x.data(), x.size());
+    }
+};
+
+#endif
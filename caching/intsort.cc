@@ -0,0 +1,310 @@
+#include "intsort.hh"
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Ranges this small are insertion sorted.
+#define INSERTION_CUTOFF 16
+// Parallel quicksort sorts ranges this small without making tasks.
+#define TASK_CUTOFF 8192
+
+
+static void insertion_sort(int* a, int n) {
+    for (int i = 1; i < n; ++i) {
+        int x = a[i];
+        int j = i;
+        for (; j > 0 && a[j - 1] > x; --j) {
+            a[j] = a[j - 1];
+        }
+        a[j] = x;
+    }
+}
+
+// Partition `a[0..n)` around the median of its first, middle, and last
+// elements. Returns `p` such that every element of `a[0..p)` is <= every
+// element of `a[p..n)`, with 0 < p < n.
+static int partition(int* a, int n) {
+    int m = (n - 1) / 2;     // lower middle, so p < n even if pivot is max
+    if (a[m] < a[0]) {
+        std::swap(a[m], a[0]);
+    }
+    if (a[n - 1] < a[0]) {
+        std::swap(a[n - 1], a[0]);
+    }
+    if (a[n - 1] < a[m]) {
+        std::swap(a[n - 1], a[m]);
+    }
+    int pivot = a[m];
+    int i = -1, j = n;
+    while (true) {
+        do {
+            ++i;
+        } while (a[i] < pivot);
+        do {
+            --j;
+        } while (a[j] > pivot);
+        if (i >= j) {
+            return j + 1;
+        }
+        std::swap(a[i], a[j]);
+    }
+}
+
+static void introsort_loop(int* a, int n, int depth) {
+    while (n > INSERTION_CUTOFF) {
+        if (depth == 0) {
+            std::make_heap(a, a + n);
+            std::sort_heap(a, a + n);
+            return;
+        }
+        --depth;
+        int p = partition(a, n);
+        // recurse on the smaller side to bound stack depth
+        if (p < n - p) {
+            introsort_loop(a, p, depth);
+            a += p;
+            n -= p;
+        } else {
+            introsort_loop(a + p, n - p, depth);
+            n = p;
+        }
+    }
+    insertion_sort(a, n);
+}
+
+static int depth_limit(int n) {
+    int d = 0;
+    for (; n > 1; n >>= 1) {
+        ++d;
+    }
+    return 2 * d;
+}
+
+void ints_introsort(int* array, int n) {
+    introsort_loop(array, n, depth_limit(n));
+}
+
+
+// Parallel quicksort
+
+struct qs_task {
+    int* a;
+    int n;
+};
+
+// qs_deque
+//    A worker's task deque. The owner pushes and pops at the back; thieves
+//    take from the front, where the largest tasks are.
+struct qs_deque {
+    std::mutex m;
+    std::deque<qs_task> tasks;
+};
+
+struct qs_state {
+    std::vector<qs_deque> deques;
+    std::atomic<long> unsorted;     // # elements not yet in final position
+
+    qs_state(int nthreads, long n)
+        : deques(nthreads), unsorted(n) {
+    }
+};
+
+static bool qs_pop(qs_state& qs, int self, qs_task& t) {
+    qs_deque& d = qs.deques[self];
+    std::unique_lock<std::mutex> guard(d.m);
+    if (d.tasks.empty()) {
+        return false;
+    }
+    t = d.tasks.back();
+    d.tasks.pop_back();
+    return true;
+}
+
+static bool qs_steal(qs_state& qs, int self, qs_task& t) {
+    int nthreads = qs.deques.size();
+    for (int k = 1; k < nthreads; ++k) {
+        qs_deque& d = qs.deques[(self + k) % nthreads];
+        std::unique_lock<std::mutex> guard(d.m);
+        if (!d.tasks.empty()) {
+            t = d.tasks.front();
+            d.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+static void qs_worker(qs_state& qs, int self) {
+    qs_task t;
+    while (qs.unsorted > 0) {
+        if (!qs_pop(qs, self, t) && !qs_steal(qs, self, t)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int depth = depth_limit(t.n);
+        while (t.n > TASK_CUTOFF && depth > 0) {
+            int p = partition(t.a, t.n);
+            --depth;
+            // keep the smaller half, share the larger
+            qs_task big = {t.a, p}, small = {t.a + p, t.n - p};
+            if (big.n < small.n) {
+                std::swap(big, small);
+            }
+            {
+                std::unique_lock<std::mutex> guard(qs.deques[self].m);
+                qs.deques[self].tasks.push_back(big);
+            }
+            t = small;
+        }
+        ints_introsort(t.a, t.n);
+        qs.unsorted -= t.n;
+    }
+}
+
+void ints_parallel_quicksort(int* array, int n, int nthreads) {
+    if (nthreads <= 1 || n <= TASK_CUTOFF) {
+        ints_introsort(array, n);
+        return;
+    }
+    qs_state qs(nthreads, n);
+    qs.deques[0].tasks.push_back({array, n});
+    std::vector<std::thread> th;
+    for (int i = 1; i < nthreads; ++i) {
+        th.emplace_back(qs_worker, std::ref(qs), i);
+    }
+    qs_worker(qs, 0);
+    for (auto& t : th) {
+        t.join();
+    }
+}
+
+
+// Parallel mergesort
+
+// Return the number of elements of `a` among the first `d` elements of
+// the merge of `a[0..na)` and `b[0..nb)` (the merge-path co-rank).
+static long merge_split(const int* a, long na, const int* b, long nb, long d) {
+    long lo = std::max(0L, d - nb), hi = std::min(d, na);
+    while (lo < hi) {
+        long i = (lo + hi) / 2;
+        if (a[i] <= b[d - i - 1]) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+// Merge `a[0..na)` and `b[0..nb)` into `out` using `parts` threads.
+static void parallel_merge(const int* a, long na, const int* b, long nb,
+                           int* out, int parts) {
+    auto merge_part = [=] (int p) {
+        long d0 = (na + nb) * p / parts, d1 = (na + nb) * (p + 1) / parts;
+        long i0 = merge_split(a, na, b, nb, d0);
+        long i1 = merge_split(a, na, b, nb, d1);
+        std::merge(a + i0, a + i1, b + (d0 - i0), b + (d1 - i1), out + d0);
+    };
+    std::vector<std::thread> th;
+    for (int p = 1; p < parts; ++p) {
+        th.emplace_back(merge_part, p);
+    }
+    merge_part(0);
+    for (auto& t : th) {
+        t.join();
+    }
+}
+
+void ints_parallel_mergesort(int* array, int n, int nthreads) {
+    if (nthreads <= 1 || n < 2 * nthreads) {
+        ints_introsort(array, n);
+        return;
+    }
+
+    // sort chunks
+    std::vector<long> bounds(nthreads + 1);
+    for (int i = 0; i <= nthreads; ++i) {
+        bounds[i] = (long) n * i / nthreads;
+    }
+    std::vector<std::thread> th;
+    for (int i = 0; i < nthreads; ++i) {
+        th.emplace_back(ints_introsort, array + bounds[i],
+                        (int) (bounds[i + 1] - bounds[i]));
+    }
+    for (auto& t : th) {
+        t.join();
+    }
+
+    // merge runs pairwise, alternating between `array` and `tmp`
+    int* tmp = new int[n];
+    int* src = array;
+    int* dst = tmp;
+    while (bounds.size() > 2) {
+        int nruns = bounds.size() - 1;
+        int npairs = nruns / 2;
+        int parts = std::max(nthreads / npairs, 1);
+        std::vector<long> next;
+        th.clear();
+        for (int r = 0; r < nruns; r += 2) {
+            long lo = bounds[r], mid = bounds[r + 1];
+            long hi = r + 1 < nruns ? bounds[r + 2] : mid;
+            th.emplace_back(parallel_merge, src + lo, mid - lo, src + mid,
+                            hi - mid, dst + lo, r + 1 < nruns ? parts : 1);
+            next.push_back(lo);
+        }
+        next.push_back(n);
+        for (auto& t : th) {
+            t.join();
+        }
+        bounds.swap(next);
+        std::swap(src, dst);
+    }
+    if (src != array) {
+        memcpy(array, src, sizeof(int) * n);
+    }
+    delete[] tmp;
+}
+
+
+// Radix sort
+
+void ints_radixsort(int* array, int n) {
+    // flip the sign bit so signed order matches unsigned order
+    unsigned* a = (unsigned*) array;
+    unsigned* tmp = new unsigned[n];
+    unsigned* src = a;
+    unsigned* dst = tmp;
+    for (int i = 0; i < n; ++i) {
+        a[i] ^= 0x80000000U;
+    }
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t count[256] = {0};
+        for (int i = 0; i < n; ++i) {
+            ++count[(src[i] >> shift) & 255];
+        }
+        if (n == 0 || count[(src[0] >> shift) & 255] == (size_t) n) {
+            continue;           // every element has the same digit
+        }
+        size_t pos = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t c = count[d];
+            count[d] = pos;
+            pos += c;
+        }
+        for (int i = 0; i < n; ++i) {
+            dst[count[(src[i] >> shift) & 255]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        a[i] = src[i] ^ 0x80000000U;
+    }
+    delete[] tmp;
+}
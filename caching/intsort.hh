@@ -0,0 +1,33 @@
+#ifndef INTSORT_HH
+#define INTSORT_HH
+
+// Sorting algorithms for arrays of `int`. All sort `array[0..n)` in place
+// into nondecreasing order.
+
+// ints_introsort(array, n)
+//    Sequential introsort: median-of-three quicksort that switches to
+//    heapsort if recursion gets too deep (so the worst case stays
+//    O(n log n)) and to insertion sort for small ranges.
+void ints_introsort(int* array, int n);
+
+// ints_parallel_quicksort(array, n, nthreads)
+//    Quicksort on `nthreads` threads. Each partition step pushes one half
+//    onto the partitioning thread's own task deque and continues with the
+//    other; idle threads steal the oldest (largest) tasks from other
+//    threads' deques. Small ranges are finished with `ints_introsort`.
+void ints_parallel_quicksort(int* array, int n, int nthreads);
+
+// ints_parallel_mergesort(array, n, nthreads)
+//    Sort `nthreads` chunks concurrently with `ints_introsort`, then merge
+//    them pairwise. When a round has fewer merges than threads, each merge
+//    is itself split among threads by merge-path partitioning. Uses `n`
+//    ints of temporary space.
+void ints_parallel_mergesort(int* array, int n, int nthreads);
+
+// ints_radixsort(array, n)
+//    Least-significant-digit radix sort with 8-bit digits. Passes whose
+//    digit is the same for every element are skipped. Uses `n` ints of
+//    temporary space.
+void ints_radixsort(int* array, int n);
+
+#endif
@@ -0,0 +1,381 @@
+#include "io61.hh"
+#include "cachepolicy.hh"
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cassert>
+#include <climits>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// Blocks at most this far apart are fetched with one `preadv`, together
+// with the uncached blocks between them.
+#define IO61_MAXGAP 2
+
+enum io61_pattern {
+    pattern_none, pattern_sequential, pattern_reverse, pattern_strided
+};
+static const char* const pattern_names[] = {
+    "none", "sequential", "reverse", "strided"
+};
+
+struct io61_slot {
+    off_t block = -1;           // block number, -1 if empty, -2 if filling
+    size_t len = 0;             // # valid bytes (< block_size at EOF)
+    bool prefetched = false;    // read ahead and not yet used
+    char* data;
+};
+
+struct io61_file {
+    int fd;
+    size_t block_size;
+    size_t readahead;
+    off_t size;                 // file size
+    off_t pos = 0;              // file position
+    std::vector<io61_slot> slots;
+    std::unordered_map<off_t, size_t> index;  // block number -> slot
+    std::vector<size_t> free;   // empty slots
+    cache_policy* policy;
+    char* buf;
+
+    // access pattern detection
+    off_t last_pos = -1;        // offset of previous read
+    size_t last_sz = 0;         // size of previous read
+    off_t delta = 0;            // offset difference between recent reads
+    int streak = 0;             // # consecutive reads with that difference
+    io61_pattern pattern = pattern_none;
+
+    // statistics
+    size_t naccesses = 0;       // # block accesses
+    size_t nhits = 0;           // # accesses to cached blocks
+    size_t nprefetched = 0;     // # blocks read ahead
+    size_t nprefetch_hits = 0;  // # read-ahead blocks later used
+    size_t nsyscalls = 0;
+    size_t nfetched = 0;        // # bytes read by system calls
+};
+
+
+io61_file* io61_fdopen(int fd, size_t block_size, size_t nslots,
+                       size_t readahead, const char* policy) {
+    struct stat s;
+    if (fstat(fd, &s) != 0) {
+        return nullptr;
+    }
+    cache_policy* p = nullptr;
+    if (!S_ISREG(s.st_mode) || block_size == 0 || nslots < 4
+        || !(p = cache_policy_create(policy, nslots))) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    io61_file* f = new io61_file;
+    f->policy = p;
+    f->fd = fd;
+    f->block_size = block_size;
+    f->readahead = std::min(readahead, nslots / 2 - 1);
+    f->size = s.st_size;
+    f->buf = (char*) malloc(block_size * nslots);
+    f->slots.resize(nslots);
+    for (size_t i = 0; i != nslots; ++i) {
+        f->slots[i].data = &f->buf[i * block_size];
+        f->free.push_back(nslots - 1 - i);
+    }
+    return f;
+}
+
+int io61_close(io61_file* f) {
+    int r = close(f->fd);
+    free(f->buf);
+    delete f->policy;
+    delete f;
+    return r;
+}
+
+int io61_seek(io61_file* f, off_t pos) {
+    if (pos < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    f->pos = pos;
+    return 0;
+}
+
+
+// Update the detected access pattern given a read of `sz` bytes at `pos`.
+// A pattern is established once two consecutive reads move by the same
+// nonzero amount.
+static void io61_detect(io61_file* f, off_t pos, size_t sz) {
+    if (f->last_pos >= 0) {
+        off_t d = pos - f->last_pos;
+        if (d != 0 && d == f->delta) {
+            ++f->streak;
+        } else {
+            f->delta = d;
+            f->streak = d != 0;
+        }
+    }
+    off_t last_sz = f->last_sz;
+    f->last_pos = pos;
+    f->last_sz = sz;
+
+    if (f->streak < 2) {
+        f->pattern = pattern_none;
+    } else if (f->delta == last_sz) {
+        f->pattern = pattern_sequential;
+    } else if (f->delta == -last_sz) {
+        f->pattern = pattern_reverse;
+    } else {
+        f->pattern = pattern_strided;
+    }
+}
+
+// Append to `want` the next `f->readahead` blocks the current pattern will
+// touch after block `blk`.
+static void io61_predict(io61_file* f, off_t blk, std::vector<off_t>& want) {
+    off_t bs = f->block_size;
+    off_t nblocks = (f->size + bs - 1) / bs;
+    if (f->pattern != pattern_strided || (f->delta > -bs && f->delta < bs)) {
+        // contiguous or small steps: the next blocks in the same direction
+        off_t dir = f->delta > 0 ? 1 : -1;
+        for (size_t i = 1; i <= f->readahead; ++i) {
+            off_t b = blk + dir * (off_t) i;
+            if (b < 0 || b >= nblocks) {
+                break;
+            }
+            want.push_back(b);
+        }
+    } else {
+        // large steps: the blocks containing the next reads
+        size_t n = 0;
+        for (off_t i = 1; n < f->readahead; ++i) {
+            off_t off = f->last_pos + i * f->delta;
+            if (off < 0 || off >= f->size) {
+                break;
+            }
+            off_t end = std::min(off + (off_t) f->last_sz, f->size);
+            for (off_t b = off / bs; b * bs < end && n < f->readahead; ++b, ++n) {
+                want.push_back(b);
+            }
+        }
+    }
+}
+
+// Return the index of an empty slot, or else of the slot chosen by the
+// replacement policy. Slots being filled by the current fetch are not
+// tracked by the policy, so they are never chosen.
+static size_t io61_victim(io61_file* f) {
+    if (!f->free.empty()) {
+        size_t i = f->free.back();
+        f->free.pop_back();
+        return i;
+    }
+    size_t i = f->policy->evict();
+    assert(f->slots[i].block >= 0);
+    f->index.erase(f->slots[i].block);
+    return i;
+}
+
+// Read blocks [first, last] into cache slots with one `preadv`.
+static int io61_fetch_run(io61_file* f, off_t first, off_t last,
+                          off_t demand) {
+    size_t n = last - first + 1;
+    std::vector<struct iovec> iov(n);
+    std::vector<size_t> slotidx(n);
+    for (size_t i = 0; i != n; ++i) {
+        size_t si = io61_victim(f);
+        io61_slot& s = f->slots[si];
+        s.block = -2;           // being filled
+        iov[i].iov_base = s.data;
+        iov[i].iov_len = f->block_size;
+        slotidx[i] = si;
+    }
+
+    ssize_t r;
+    do {
+        r = preadv(f->fd, iov.data(), n, first * f->block_size);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) {
+        for (size_t i = 0; i != n; ++i) {
+            f->slots[slotidx[i]].block = -1;
+            f->free.push_back(slotidx[i]);
+        }
+        return -1;
+    }
+    ++f->nsyscalls;
+    f->nfetched += r;
+
+    for (size_t i = 0; i != n; ++i) {
+        io61_slot& s = f->slots[slotidx[i]];
+        size_t start = i * f->block_size;
+        s.block = -1;
+        if ((size_t) r > start) {
+            s.block = first + i;
+            s.len = std::min((size_t) r - start, f->block_size);
+            s.prefetched = s.block != demand;
+            f->nprefetched += s.prefetched;
+            f->index[s.block] = slotidx[i];
+            f->policy->insert(slotidx[i], s.block);
+        } else {
+            f->free.push_back(slotidx[i]);
+        }
+    }
+    return 0;
+}
+
+// Fetch the uncached blocks in `want`, grouping nearby blocks into runs.
+// At most a quarter of the cache is spent on bridging gaps. The run
+// containing `demand` is fetched last, so fetching the other runs cannot
+// evict it.
+static int io61_fetch(io61_file* f, std::vector<off_t>& want, off_t demand) {
+    off_t maxrun = std::min(f->slots.size() / 2, (size_t) IOV_MAX);
+    off_t gap_budget = f->slots.size() / 4;
+    want.erase(std::remove_if(want.begin(), want.end(), [&] (off_t b) {
+                   return f->index.count(b) != 0;
+               }), want.end());
+    std::sort(want.begin(), want.end());
+    want.erase(std::unique(want.begin(), want.end()), want.end());
+
+    std::vector<std::pair<off_t, off_t>> runs;
+    size_t i = 0;
+    while (i != want.size()) {
+        off_t first = want[i], last = want[i];
+        for (++i; i != want.size(); ++i) {
+            off_t b = want[i];
+            off_t gap = b - last - 1;
+            bool bridge = gap <= IO61_MAXGAP && gap <= gap_budget
+                && b - first < maxrun;
+            for (off_t g = last + 1; bridge && g < b; ++g) {
+                bridge = f->index.count(g) == 0;
+            }
+            if (!bridge) {
+                break;
+            }
+            gap_budget -= gap;
+            last = b;
+        }
+        if (first <= demand && demand <= last) {
+            runs.insert(runs.end(), {first, last});
+        } else {
+            runs.insert(runs.begin(), {first, last});
+        }
+    }
+    for (auto& r : runs) {
+        if (io61_fetch_run(f, r.first, r.second, demand) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Called on the first use of read-ahead block `blk`: refill the readahead
+// window once half of it has been consumed.
+static void io61_refill(io61_file* f, off_t blk) {
+    if (f->pattern == pattern_none) {
+        return;
+    }
+    std::vector<off_t> want;
+    io61_predict(f, blk, want);
+    size_t nmissing = std::count_if(want.begin(), want.end(),
+        [&] (off_t b) { return f->index.count(b) == 0; });
+    if (nmissing >= std::max(f->readahead / 2, (size_t) 1)) {
+        io61_fetch(f, want, -1);        // errors surface on demand reads
+    }
+}
+
+// Return the slot holding block `blk`, reading it (and any readahead)
+// if necessary. Returns nullptr on error. Sets `*refill` if the caller
+// should call `io61_refill` once it has used the slot (refilling first
+// could evict the slot).
+static io61_slot* io61_access(io61_file* f, off_t blk, bool* refill) {
+    ++f->naccesses;
+    *refill = false;
+    std::vector<off_t> want;
+    auto it = f->index.find(blk);
+    if (it != f->index.end()) {
+        ++f->nhits;
+        io61_slot* s = &f->slots[it->second];
+        f->policy->touch(it->second);
+        if (s->prefetched) {
+            ++f->nprefetch_hits;
+            s->prefetched = false;
+            *refill = true;
+        }
+        return s;
+    }
+
+    want.push_back(blk);
+    if (f->pattern != pattern_none) {
+        io61_predict(f, blk, want);
+    }
+    if (io61_fetch(f, want, blk) < 0) {
+        return nullptr;
+    }
+    it = f->index.find(blk);
+    return it != f->index.end() ? &f->slots[it->second] : nullptr;
+}
+
+ssize_t io61_read(io61_file* f, char* buf, size_t sz) {
+    if (f->pos >= f->size) {
+        return 0;
+    }
+    sz = std::min(sz, (size_t) (f->size - f->pos));
+    io61_detect(f, f->pos, sz);
+
+    if (sz >= f->block_size * f->slots.size() / 2) {
+        // too big to cache usefully: read directly into `buf`
+        ssize_t r;
+        do {
+            r = pread(f->fd, buf, sz, f->pos);
+        } while (r < 0 && errno == EINTR);
+        if (r > 0) {
+            ++f->nsyscalls;
+            f->nfetched += r;
+            f->naccesses += (r + f->block_size - 1) / f->block_size;
+            f->pos += r;
+        }
+        return r;
+    }
+
+    size_t n = 0;
+    while (n < sz) {
+        off_t off = f->pos + n;
+        bool refill;
+        io61_slot* s = io61_access(f, off / f->block_size, &refill);
+        if (!s) {
+            break;
+        }
+        size_t boff = off % f->block_size;
+        if (boff >= s->len) {
+            break;              // file shrank
+        }
+        size_t m = std::min(sz - n, s->len - boff);
+        memcpy(&buf[n], &s->data[boff], m);
+        n += m;
+        if (refill) {
+            io61_refill(f, off / f->block_size);
+        }
+    }
+    if (n == 0 && sz != 0) {
+        return -1;
+    }
+    f->pos += n;
+    return n;
+}
+
+size_t io61_nsyscalls(io61_file* f) {
+    return f->nsyscalls;
+}
+
+void io61_print_stats(io61_file* f, FILE* out) {
+    fprintf(out, "io61: %zu accesses   %.2f%% hit rate   %zu syscalls   %g bytes/syscall\n",
+            f->naccesses,
+            f->naccesses ? 100.0 * f->nhits / f->naccesses : 0.0,
+            f->nsyscalls,
+            f->nsyscalls ? f->nfetched / (double) f->nsyscalls : 0.0);
+    fprintf(out, "io61: %s pattern   %zu blocks read ahead   %zu used   %s replacement\n",
+            pattern_names[f->pattern], f->nprefetched, f->nprefetch_hits,
+            f->policy->name());
+}
@@ -0,0 +1,36 @@
+#ifndef IO61_HH
+#define IO61_HH
+#include <cstdio>
+#include <sys/types.h>
+
+// io61
+//    A userspace read cache for seekable files.
+//
+//    The cache holds `nslots` aligned blocks of `block_size` bytes. On every
+//    read it looks at the offsets of recent reads to detect a sequential,
+//    reverse, or strided access pattern. Once a pattern is established, a
+//    miss (or the first use of a prefetched block) reads ahead the next
+//    `readahead` blocks the pattern will touch. Blocks that are adjacent in
+//    the file are fetched with a single `preadv`.
+//
+//    `policy` names the replacement policy used when the cache is full
+//    ("lru", "clock", "2q", "arc", or "lfu"; see cachepolicy.hh).
+
+struct io61_file;
+
+io61_file* io61_fdopen(int fd, size_t block_size = 4096, size_t nslots = 64,
+                       size_t readahead = 8, const char* policy = "lru");
+int io61_close(io61_file* f);
+
+// Read up to `sz` bytes at the current file position. Returns the number
+// of bytes read, 0 at end of file, or -1 on error.
+ssize_t io61_read(io61_file* f, char* buf, size_t sz);
+// Change the file position. Returns 0 on success and -1 on error.
+int io61_seek(io61_file* f, off_t pos);
+
+// Return the number of system calls `f` has made to read data.
+size_t io61_nsyscalls(io61_file* f);
+// Print cache statistics (hit rate, system calls, bytes per system call).
+void io61_print_stats(io61_file* f, FILE* out);
+
+#endif
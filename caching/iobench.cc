@@ -0,0 +1,616 @@
+#include "iobench.hh"
+#include "wcache.hh"
+#include "uring.hh"
+#include "io61.hh"
+#include "mmapread.hh"
+#include "directio.hh"
+#include "perfcounters.hh"
+#include "allowexec.hh"
+#include <cerrno>
+#include <cinttypes>
+#include <vector>
+#include <algorithm>
+
+// iobench: one driver for all the read and write strategies.
+//
+// Usage: ./iobench [-l] [-s STRATEGY,...] [-b BLOCKSIZES] [-f FILESIZES]
+//                  [-o csv|json] [-c] [-S] [-q DEPTH] [-e] [FILE]
+//
+//    Runs every selected strategy (default: all; `-l` lists them) for
+//    every combination of block size and file size, and prints one
+//    CSV row or JSON object per run to stdout. Sizes are comma-separated
+//    and may use K, M, and G suffixes. `-c` evicts FILE from the page cache
+//    before each read run; `-S` includes an `fsync` in each write run;
+//    `-q` sets the queue depth for the async strategy. `-e` adds hardware
+//    event counts for each run (see perfcounters.hh). FILE defaults to
+//    DATAFILE.
+//
+//    Each run reports throughput, system calls per operation, and the
+//    latency distribution of individual operations (one operation is one
+//    block, or one byte for the `*-byte` strategies).
+
+struct bench_config {
+    const char* path;
+    size_t file_size;
+    size_t block_size;
+    unsigned depth;
+    bool cold;
+    bool sync;
+};
+
+struct bench_result {
+    size_t nbytes = 0;
+    size_t nsyscalls = 0;
+    uint64_t checksum = 0;
+    latency_histogram lat;            // per-operation, in `cycles()`
+    const char* skipped = nullptr;    // reason the strategy couldn't run
+};
+
+struct bench_strategy {
+    const char* name;
+    bool write;
+    bool byte_at_a_time;    // ignores the block size
+    void (*run)(const bench_config& c, bench_result& r);
+};
+
+
+// Run `f()`, recording its latency as one operation.
+template <typename F>
+static inline auto timed(bench_result& r, F f) {
+    uint64_t t0 = cycles();
+    auto x = f();
+    r.lat.record(cycles_since(t0));
+    return x;
+}
+
+static int open_or_die(const char* path, int flags) {
+    int fd = open(path, flags, 0666);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    return fd;
+}
+
+static void check_io(ssize_t r, size_t expected, const char* what) {
+    if (r != (ssize_t) expected) {
+        if (r < 0) {
+            perror(what);
+        } else {
+            fprintf(stderr, "%s: short transfer\n", what);
+        }
+        exit(1);
+    }
+}
+
+static uint64_t block_checksum(const void* data, size_t sz) {
+    const unsigned char* p = (const unsigned char*) data;
+    uint64_t sum = 0;
+    for (size_t i = 0; i != sz; ++i) {
+        sum += p[i];
+    }
+    return sum;
+}
+
+static void finish_write(const bench_config& c, bench_result& r, int fd) {
+    if (c.sync) {
+        fsync(fd);
+        ++r.nsyscalls;
+    }
+    close(fd);
+}
+
+static char* make_block(size_t sz) {
+    void* p;
+    if (posix_memalign(&p, 4096, std::max(sz, (size_t) 1)) != 0) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    memset(p, '6', sz);
+    return (char*) p;
+}
+
+
+// stdio streams whose underlying `read`/`write` calls are counted
+
+struct counted_fd {
+    int fd;
+    size_t* nsyscalls;
+};
+
+static ssize_t counted_read(void* cookie, char* buf, size_t sz) {
+    counted_fd* cf = (counted_fd*) cookie;
+    ++*cf->nsyscalls;
+    return read(cf->fd, buf, sz);
+}
+
+static ssize_t counted_write(void* cookie, const char* buf, size_t sz) {
+    counted_fd* cf = (counted_fd*) cookie;
+    ++*cf->nsyscalls;
+    return write(cf->fd, buf, sz);
+}
+
+static int counted_close(void* cookie) {
+    counted_fd* cf = (counted_fd*) cookie;
+    int r = close(cf->fd);
+    delete cf;
+    return r;
+}
+
+static FILE* counted_fdopen(int fd, const char* mode, size_t* nsyscalls) {
+    cookie_io_functions_t fns = {
+        counted_read, counted_write, nullptr, counted_close
+    };
+    return fopencookie(new counted_fd{fd, nsyscalls}, mode, fns);
+}
+
+
+// write strategies
+
+static void write_byte(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_WRONLY | O_CREAT | O_TRUNC);
+    char ch = '6';
+    for (size_t n = 0; n != c.file_size; ++n) {
+        check_io(timed(r, [&] { return write(fd, &ch, 1); }), 1, "write");
+        ++r.nsyscalls;
+    }
+    r.nbytes = c.file_size;
+    finish_write(c, r, fd);
+}
+
+static void write_block(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_WRONLY | O_CREAT | O_TRUNC);
+    char* buf = make_block(c.block_size);
+    for (size_t n = 0; n < c.file_size; n += c.block_size) {
+        size_t sz = std::min(c.block_size, c.file_size - n);
+        check_io(timed(r, [&] { return write(fd, buf, sz); }), sz, "write");
+        ++r.nsyscalls;
+    }
+    r.nbytes = c.file_size;
+    finish_write(c, r, fd);
+    free(buf);
+}
+
+static void write_stdio(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_WRONLY | O_CREAT | O_TRUNC);
+    FILE* f = counted_fdopen(dup(fd), "w", &r.nsyscalls);
+    char* buf = make_block(c.block_size);
+    for (size_t n = 0; n < c.file_size; n += c.block_size) {
+        size_t sz = std::min(c.block_size, c.file_size - n);
+        check_io(timed(r, [&] { return fwrite(buf, 1, sz, f); }), sz, "fwrite");
+    }
+    fclose(f);
+    r.nbytes = c.file_size;
+    finish_write(c, r, fd);
+    free(buf);
+}
+
+static void write_cache(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_WRONLY | O_CREAT | O_TRUNC);
+    char* buf = make_block(c.block_size);
+    {
+        wcache wc(fd, 65536, 4, 4, false);
+        for (size_t n = 0; n < c.file_size; n += c.block_size) {
+            size_t sz = std::min(c.block_size, c.file_size - n);
+            check_io(timed(r, [&] { return wc.write(buf, sz); }), sz, "write");
+        }
+        wc.flush();
+        r.nsyscalls = wc.nsyscalls();
+    }
+    r.nbytes = c.file_size;
+    finish_write(c, r, fd);
+    free(buf);
+}
+
+static void write_mmap(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_RDWR | O_CREAT | O_TRUNC);
+    char* buf = make_block(c.block_size);
+    if (ftruncate(fd, c.file_size) != 0) {
+        perror("ftruncate");
+        exit(1);
+    }
+    char* map = (char*) mmap(nullptr, c.file_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    madvise(map, c.file_size, MADV_SEQUENTIAL);
+    for (size_t n = 0; n < c.file_size; n += c.block_size) {
+        size_t sz = std::min(c.block_size, c.file_size - n);
+        timed(r, [&] { return memcpy(&map[n], buf, sz); });
+    }
+    if (c.sync) {
+        msync(map, c.file_size, MS_SYNC);
+        ++r.nsyscalls;
+    }
+    munmap(map, c.file_size);
+    r.nsyscalls += 4;       // ftruncate, mmap, madvise, munmap
+    r.nbytes = c.file_size;
+    close(fd);
+    free(buf);
+}
+
+static void write_direct(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_WRONLY | O_CREAT | O_TRUNC);
+    char* buf = make_block(c.block_size);
+    {
+        direct_writer dw(fd, c.block_size);
+        for (size_t n = 0; n < c.file_size; n += c.block_size) {
+            size_t sz = std::min(c.block_size, c.file_size - n);
+            check_io(timed(r, [&] { return dw.write(buf, sz); }), sz, "write");
+        }
+        dw.flush();
+        r.nsyscalls = dw.nsyscalls();
+        if (strcmp(dw.method(), "O_DIRECT") != 0) {
+            r.skipped = "O_DIRECT not supported by filesystem";
+        }
+    }
+    r.nbytes = c.file_size;
+    finish_write(c, r, fd);
+    free(buf);
+}
+
+static void write_async(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_WRONLY | O_CREAT | O_TRUNC);
+    char* buf = make_block(c.block_size);
+    {
+        uring_writer uw(fd, c.block_size, c.depth);
+        for (size_t n = 0; n < c.file_size; n += c.block_size) {
+            size_t sz = std::min(c.block_size, c.file_size - n);
+            check_io(timed(r, [&] { return uw.write(buf, sz); }), sz, "write");
+        }
+        uw.flush();
+        r.nsyscalls = uw.nsyscalls();
+    }
+    r.nbytes = c.file_size;
+    finish_write(c, r, fd);
+    free(buf);
+}
+
+
+// read strategies
+
+static void read_byte(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_RDONLY);
+    unsigned char ch;
+    ssize_t n;
+    while ((n = timed(r, [&] { return read(fd, &ch, 1); })) > 0) {
+        ++r.nsyscalls;
+        r.checksum += ch;
+        ++r.nbytes;
+    }
+    ++r.nsyscalls;          // the read that returned EOF
+    check_io(n, 0, "read");
+    close(fd);
+}
+
+static void read_block(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_RDONLY);
+    char* buf = make_block(c.block_size);
+    ssize_t n;
+    while ((n = timed(r, [&] { return read(fd, buf, c.block_size); })) > 0) {
+        ++r.nsyscalls;
+        r.checksum += block_checksum(buf, n);
+        r.nbytes += n;
+    }
+    ++r.nsyscalls;
+    check_io(n, 0, "read");
+    close(fd);
+    free(buf);
+}
+
+static void read_stdio(const bench_config& c, bench_result& r) {
+    FILE* f = counted_fdopen(open_or_die(c.path, O_RDONLY), "r", &r.nsyscalls);
+    char* buf = make_block(c.block_size);
+    size_t n;
+    while ((n = timed(r, [&] { return fread(buf, 1, c.block_size, f); })) > 0) {
+        r.checksum += block_checksum(buf, n);
+        r.nbytes += n;
+    }
+    fclose(f);
+    free(buf);
+}
+
+static void read_cache(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_RDONLY);
+    io61_file* f = io61_fdopen(fd);
+    if (!f) {
+        r.skipped = errno == EINVAL ? "io61 cache needs a regular file"
+            : "io61 cache cannot stat file";
+        close(fd);
+        return;
+    }
+    char* buf = make_block(c.block_size);
+    ssize_t n;
+    while ((n = timed(r, [&] { return io61_read(f, buf, c.block_size); })) > 0) {
+        r.checksum += block_checksum(buf, n);
+        r.nbytes += n;
+    }
+    check_io(n, 0, "io61_read");
+    r.nsyscalls = io61_nsyscalls(f);
+    io61_close(f);
+    free(buf);
+}
+
+static void read_mmap(const bench_config& c, bench_result& r) {
+    int fd = open_or_die(c.path, O_RDONLY);
+    ssize_t size = filesize(fd);
+    mmap_file mf = mmap_open(fd, size, MADV_SEQUENTIAL, false);
+    if (size > 0 && !mf.data) {
+        perror("mmap");
+        exit(1);
+    }
+    for (size_t n = 0; n < mf.size; n += c.block_size) {
+        size_t sz = std::min(c.block_size, mf.size - n);
+        r.checksum += timed(r, [&] { return block_checksum(&mf.data[n], sz); });
+    }
+    r.nbytes = mf.size;
+    r.nsyscalls = 4;        // fstat, mmap, madvise, munmap
+    mmap_close(mf);
+    close(fd);
+}
+
+static void read_direct(const bench_config& c, bench_result& r) {
+    if (c.block_size % direct_alignment() != 0) {
+        r.skipped = "O_DIRECT reads need page-aligned block sizes";
+        return;
+    }
+    int fd = open(c.path, O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        r.skipped = "O_DIRECT not supported by filesystem";
+        return;
+    }
+    char* buf = (char*) direct_alloc(c.block_size);
+    ssize_t n;
+    while ((n = timed(r, [&] { return read(fd, buf, c.block_size); })) > 0) {
+        ++r.nsyscalls;
+        r.checksum += block_checksum(buf, n);
+        r.nbytes += n;
+    }
+    ++r.nsyscalls;
+    check_io(n, 0, "read");
+    close(fd);
+    direct_free(buf, c.block_size);
+}
+
+
+// the strategy registry: add new strategies here
+
+static const bench_strategy strategies[] = {
+    { "write-byte", true, true, write_byte },
+    { "write-block", true, false, write_block },
+    { "write-stdio", true, false, write_stdio },
+    { "write-cache", true, false, write_cache },
+    { "write-mmap", true, false, write_mmap },
+    { "write-direct", true, false, write_direct },
+    { "write-async", true, false, write_async },
+    { "read-byte", false, true, read_byte },
+    { "read-block", false, false, read_block },
+    { "read-stdio", false, false, read_stdio },
+    { "read-cache", false, false, read_cache },
+    { "read-mmap", false, false, read_mmap },
+    { "read-direct", false, false, read_direct }
+};
+
+
+// Create `c.path` with exactly `c.file_size` bytes, and evict it from the
+// page cache if `c.cold`.
+static void prepare_read(const bench_config& c) {
+    int fd = open_or_die(c.path, O_RDWR | O_CREAT);
+    if (filesize(fd) != (ssize_t) c.file_size) {
+        bench_config wc = c;
+        wc.block_size = 65536;
+        bench_result wr;
+        close(fd);
+        write_block(wc, wr);
+        fd = open_or_die(c.path, O_RDWR);
+    }
+    if (c.cold) {
+        fsync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    close(fd);
+}
+
+// Parse a comma-separated list of sizes with optional K/M/G suffixes.
+static std::vector<size_t> parse_sizes(const char* arg) {
+    std::vector<size_t> sizes;
+    const char* s = arg;
+    while (*s) {
+        char* end;
+        unsigned long long v = strtoull(s, &end, 0);
+        if (end == s) {
+            fprintf(stderr, "bad size list `%s`\n", arg);
+            exit(1);
+        }
+        if (*end == 'K' || *end == 'k') {
+            v <<= 10, ++end;
+        } else if (*end == 'M' || *end == 'm') {
+            v <<= 20, ++end;
+        } else if (*end == 'G' || *end == 'g') {
+            v <<= 30, ++end;
+        }
+        if (v == 0 || (*end != ',' && *end != 0)) {
+            fprintf(stderr, "bad size list `%s`\n", arg);
+            exit(1);
+        }
+        sizes.push_back(v);
+        s = *end ? end + 1 : end;
+    }
+    return sizes;
+}
+
+// Print the counts in `pc` as JSON fields or CSV columns. Unavailable
+// events are omitted from JSON and left empty in CSV.
+static void print_counters(const perf_counters* pc, bool json, bool skipped) {
+    for (int e = 0; pc && e != perf_nevents; ++e) {
+        perf_event_id pe = (perf_event_id) e;
+        if (json && !skipped && pc->available(pe)) {
+            printf(", \"%s\": %" PRIu64, perf_counters::name(pe), pc->value(pe));
+        } else if (!json && (skipped || !pc->available(pe))) {
+            printf(",");
+        } else if (!json) {
+            printf(",%" PRIu64, pc->value(pe));
+        }
+    }
+}
+
+static void print_result(const bench_strategy& s, const bench_config& c,
+                         bench_result& r, double elapsed,
+                         const perf_counters* pc, bool json, bool first) {
+    size_t nops = r.lat.n;
+    double ns = 1e9 / cycles_per_sec();
+    uint64_t p50 = r.lat.percentile(0.5) * ns, p99 = r.lat.percentile(0.99) * ns,
+        p999 = r.lat.percentile(0.999) * ns, max = r.lat.max * ns;
+    size_t block_size = s.byte_at_a_time ? 1 : c.block_size;
+    if (json) {
+        printf("%s\n  {\"strategy\": \"%s\", \"file_size\": %zu, \"block_size\": %zu",
+               first ? "[" : ",", s.name, c.file_size, block_size);
+        if (r.skipped) {
+            printf(", \"skipped\": \"%s\"}", r.skipped);
+            fflush(stdout);
+            return;
+        }
+        printf(", \"bytes\": %zu, \"seconds\": %.6f, \"bytes_per_sec\": %.0f"
+               ", \"ops\": %zu, \"syscalls\": %zu, \"syscalls_per_op\": %.4f"
+               ", \"p50_ns\": %" PRIu64 ", \"p99_ns\": %" PRIu64
+               ", \"p999_ns\": %" PRIu64 ", \"max_ns\": %" PRIu64
+               ", \"checksum\": %" PRIu64,
+               r.nbytes, elapsed, r.nbytes / elapsed, nops, r.nsyscalls,
+               nops ? r.nsyscalls / (double) nops : 0.0,
+               p50, p99, p999, max, r.checksum);
+        print_counters(pc, json, false);
+        printf("}");
+    } else {
+        if (first) {
+            printf("strategy,file_size,block_size,bytes,seconds,bytes_per_sec,"
+                   "ops,syscalls,syscalls_per_op,p50_ns,p99_ns,p999_ns,max_ns,"
+                   "checksum,skipped");
+            for (int e = 0; pc && e != perf_nevents; ++e) {
+                printf(",%s", perf_counters::name((perf_event_id) e));
+            }
+            printf("\n");
+        }
+        if (r.skipped) {
+            printf("%s,%zu,%zu,,,,,,,,,,,,%s", s.name, c.file_size,
+                   block_size, r.skipped);
+        } else {
+            printf("%s,%zu,%zu,%zu,%.6f,%.0f,%zu,%zu,%.4f,%" PRIu64 ",%" PRIu64
+                   ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",",
+                   s.name, c.file_size, block_size, r.nbytes, elapsed,
+                   r.nbytes / elapsed, nops, r.nsyscalls,
+                   nops ? r.nsyscalls / (double) nops : 0.0,
+                   p50, p99, p999, max, r.checksum);
+        }
+        print_counters(pc, json, r.skipped != nullptr);
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [-l] [-s STRATEGY,...] [-b BLOCKSIZES] [-f FILESIZES] [-o csv|json] [-c] [-S] [-q DEPTH] [-e] [FILE]\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    bench_config c;
+    c.path = DATAFILE;
+    c.depth = 8;
+    c.cold = c.sync = false;
+    std::vector<size_t> block_sizes = {512, 4096, 65536};
+    std::vector<size_t> file_sizes = {1 << 20};
+    const char* selected = nullptr;
+    bool json = false;
+    perf_counters* pc = nullptr;
+
+    int ch;
+    while ((ch = getopt(argc, argv, "ls:b:f:o:cSq:e")) != -1) {
+        if (ch == 'l') {
+            for (auto& s : strategies) {
+                printf("%s\n", s.name);
+            }
+            exit(0);
+        } else if (ch == 's') {
+            selected = optarg;
+        } else if (ch == 'b') {
+            block_sizes = parse_sizes(optarg);
+        } else if (ch == 'f') {
+            file_sizes = parse_sizes(optarg);
+        } else if (ch == 'o' && strcmp(optarg, "csv") == 0) {
+            json = false;
+        } else if (ch == 'o' && strcmp(optarg, "json") == 0) {
+            json = true;
+        } else if (ch == 'c') {
+            c.cold = true;
+        } else if (ch == 'S') {
+            c.sync = true;
+        } else if (ch == 'q' && strisnumber(optarg) && atoi(optarg) > 0) {
+            c.depth = atoi(optarg);
+        } else if (ch == 'e') {
+            pc = pc ? pc : new perf_counters;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (optind + 1 < argc) {
+        usage(argv[0]);
+    } else if (optind < argc) {
+        c.path = argv[optind];
+    }
+
+    // choose strategies
+    std::vector<const bench_strategy*> chosen;
+    for (auto& s : strategies) {
+        if (!selected) {
+            chosen.push_back(&s);
+        }
+    }
+    for (const char* p = selected; p && *p; ) {
+        size_t len = strcspn(p, ",");
+        auto it = std::find_if(std::begin(strategies), std::end(strategies),
+            [&] (const bench_strategy& s) {
+                return strlen(s.name) == len && memcmp(s.name, p, len) == 0;
+            });
+        if (it == std::end(strategies)) {
+            fprintf(stderr, "%s: unknown strategy `%.*s` (try -l)\n",
+                    argv[0], (int) len, p);
+            exit(1);
+        }
+        chosen.push_back(it);
+        p += len + (p[len] == ',');
+    }
+
+    bool first = true;
+    for (size_t file_size : file_sizes) {
+        c.file_size = file_size;
+        for (auto s : chosen) {
+            for (size_t block_size : block_sizes) {
+                c.block_size = block_size;
+                if (!s->write) {
+                    prepare_read(c);
+                }
+                bench_result r;
+                if (pc) {
+                    pc->start();
+                }
+                double start = tstamp();
+                s->run(c, r);
+                double elapsed = tstamp() - start;
+                if (pc) {
+                    pc->stop();
+                }
+                print_result(*s, c, r, elapsed, pc, json, first);
+                first = false;
+                if (s->byte_at_a_time) {
+                    break;
+                }
+            }
+        }
+    }
+    if (json && !first) {
+        printf("\n]\n");
+    }
+    delete pc;
+}
@@ -12,12 +12,15 @@
 #include <string.h>
 #include <limits.h>
 #include <time.h>
-
-static inline double tstamp(void) {
-    struct timespec tv;
-    clock_gettime(CLOCK_REALTIME, &tv);
-    return tv.tv_sec + tv.tv_nsec * 1.0e-9;
-}
+#include <stdint.h>
+#include <inttypes.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include "../common/hrtime.hh"
 
 // Print a report to stderr of # bytes printed, elapsed time, and rate.
 static inline void report(size_t n, double elapsed) {
@@ -25,6 +28,187 @@ static inline void report(size_t n, double elapsed) {
             n, elapsed, n / elapsed);
 }
 
+// Print a report to stderr of # bytes and records printed, elapsed time,
+// and rates.
+static inline void report_records(size_t n, size_t nrecords, double elapsed) {
+    fprintf(stderr, "\r%zd bytes   %zd records   %.3f sec   %g byte/sec   %g records/sec     ",
+            n, nrecords, elapsed, n / elapsed, nrecords / elapsed);
+}
+
+// progress_reporter
+//    Report the progress of a benchmark loop from a background thread.
+//
+//    The loop only stores its running byte count (and, if `records` is
+//    true, its record count) with `set()`: a relaxed atomic store, which is
+//    a plain `mov` on x86, with no system call, lock, or `printf`. Every
+//    `interval` seconds the reporter thread samples the counters, prints a
+//    `report()` line to stderr, and appends the sample to `samples`, so
+//    after `stop()`, `print_series()` can show throughput over time.
+//
+//    The counters are written by one thread and read by another; they
+//    share a cache line, but the reporter reads it only once per interval.
+
+struct progress_reporter {
+    struct sample {
+        double t;               // seconds since start
+        size_t nbytes;
+        size_t nrecords;
+    };
+    std::vector<sample> samples;
+
+    explicit progress_reporter(double interval, bool records = false)
+        : interval_(interval), records_(records), start_(tstamp()) {
+        this->thread_ = std::thread([this] { this->run(); });
+    }
+    ~progress_reporter() {
+        this->stop();
+    }
+
+    void set(size_t nbytes) {
+        this->nbytes_.store(nbytes, std::memory_order_relaxed);
+    }
+    void set(size_t nbytes, size_t nrecords) {
+        this->nbytes_.store(nbytes, std::memory_order_relaxed);
+        this->nrecords_.store(nrecords, std::memory_order_relaxed);
+    }
+
+    // Stop the reporter thread, take a final sample, and return the
+    // elapsed time. The final sample is not printed; the caller reports
+    // the totals itself.
+    double stop() {
+        if (this->thread_.joinable()) {
+            {
+                std::unique_lock<std::mutex> guard(this->m_);
+                this->stopped_ = true;
+            }
+            this->cv_.notify_all();
+            this->thread_.join();
+            this->take_sample(false);
+        }
+        return this->samples.back().t;
+    }
+
+    // Print one line per sample: time, bytes, and the throughput over the
+    // interval ending at that sample.
+    void print_series(FILE* out) const {
+        fprintf(out, "%10s %14s %14s%s\n", "sec", "bytes", "byte/sec",
+                this->records_ ? "    records/sec" : "");
+        sample last = {0, 0, 0};
+        for (auto& s : this->samples) {
+            double dt = s.t - last.t;
+            fprintf(out, "%10.3f %14zu %14.6g", s.t, s.nbytes,
+                    dt > 0 ? (s.nbytes - last.nbytes) / dt : 0.0);
+            if (this->records_) {
+                fprintf(out, " %14.6g",
+                        dt > 0 ? (s.nrecords - last.nrecords) / dt : 0.0);
+            }
+            fprintf(out, "\n");
+            last = s;
+        }
+    }
+
+  private:
+    std::atomic<size_t> nbytes_{0};
+    std::atomic<size_t> nrecords_{0};
+    double interval_;
+    bool records_;
+    double start_;
+    bool stopped_ = false;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::thread thread_;
+
+    void take_sample(bool print = true) {
+        sample s;
+        s.t = tstamp() - this->start_;
+        s.nbytes = this->nbytes_.load(std::memory_order_relaxed);
+        s.nrecords = this->nrecords_.load(std::memory_order_relaxed);
+        this->samples.push_back(s);
+        if (!print) {
+            return;
+        } else if (this->records_) {
+            report_records(s.nbytes, s.nrecords, s.t);
+        } else {
+            report(s.nbytes, s.t);
+        }
+    }
+
+    void run() {
+        auto tick = std::chrono::steady_clock::now();
+        auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(this->interval_));
+        std::unique_lock<std::mutex> guard(this->m_);
+        while (true) {
+            tick += step;
+            if (this->cv_.wait_until(guard, tick, [this] { return this->stopped_; })) {
+                return;
+            }
+            this->take_sample();
+        }
+    }
+};
+
+// latency_histogram
+//    A log-bucketed (HDR-style) histogram of operation latencies in
+//    `cycles()` units. Each power of two is split into 2^`sub_bits` linear
+//    buckets, so recorded values keep about 3% precision, and recording
+//    is a few instructions with no allocation.
+
+struct latency_histogram {
+    static constexpr int sub_bits = 5;
+    static constexpr int nbuckets = (64 - sub_bits + 1) << sub_bits;
+    uint64_t counts[nbuckets] = {};
+    uint64_t n = 0;
+    uint64_t max = 0;
+
+    static int bucket(uint64_t v) {
+        if (v < (1U << sub_bits)) {
+            return v;
+        }
+        int e = 63 - __builtin_clzll(v);
+        return ((e - sub_bits + 1) << sub_bits)
+            | ((v >> (e - sub_bits)) & ((1U << sub_bits) - 1));
+    }
+    // Return the smallest value that falls in bucket `b`.
+    static uint64_t bucket_min(int b) {
+        if (b < (1 << sub_bits)) {
+            return b;
+        }
+        int e = (b >> sub_bits) + sub_bits - 1;
+        uint64_t top = (1U << sub_bits) | (b & ((1U << sub_bits) - 1));
+        return top << (e - sub_bits);
+    }
+
+    void record(uint64_t v) {
+        ++this->counts[bucket(v)];
+        ++this->n;
+        if (v > this->max) {
+            this->max = v;
+        }
+    }
+
+    // Return an upper bound on the `p`th quantile (0 <= p <= 1).
+    uint64_t percentile(double p) const {
+        uint64_t rank = (uint64_t) (p * this->n + 0.5), seen = 0;
+        for (int b = 0; b != nbuckets; ++b) {
+            seen += this->counts[b];
+            if (seen > 0 && seen >= rank) {
+                uint64_t hi = b + 1 < nbuckets ? bucket_min(b + 1) - 1 : UINT64_MAX;
+                return hi < this->max ? hi : this->max;
+            }
+        }
+        return this->max;
+    }
+};
+
+// Print a report to stderr of the latency distribution in `h`.
+static inline void report_latency(const latency_histogram& h) {
+    double ns = 1e9 / cycles_per_sec();
+    fprintf(stderr, "latency: %" PRIu64 " ops   p50 %.0f ns   p99 %.0f ns   p99.9 %.0f ns   max %.0f ns\n",
+            h.n, h.percentile(0.5) * ns, h.percentile(0.99) * ns,
+            h.percentile(0.999) * ns, h.max * ns);
+}
+
 // Return the size of a file.
 static inline ssize_t filesize(int fd) {
     struct stat s;
@@ -36,10 +220,6 @@ static inline ssize_t filesize(int fd) {
     }
 }
 
-#ifndef PRINT_FREQUENCY
-#define PRINT_FREQUENCY 4096
-#endif
-
 #ifndef DATAFILE
 #define DATAFILE "data"
 #endif
@@ -0,0 +1,94 @@
+#include "jitsum.hh"
+#include "allowexec.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <sys/mman.h>
+
+// Accumulators: eax (returned), ecx, edx, r8d. `data` arrives in rdi and
+// r9d counts loop iterations; all are caller-saved, so the kernel needs no
+// prologue.
+
+jit_sum::jit_sum(int n, int stride, int unroll) {
+#if defined(__x86_64__)
+    if (n < 0 || stride <= 0 || unroll <= 0
+        || (long) stride * unroll * 4 > INT_MAX) {
+        return;
+    }
+    long count = n ? (n - 1) / stride + 1 : 0;  // # elements summed
+    long iterations = count / unroll;
+    long leftover = count % unroll;
+
+    this->emit({0x31, 0xC0});                   // xor eax, eax
+    this->emit({0x31, 0xC9});                   // xor ecx, ecx
+    this->emit({0x31, 0xD2});                   // xor edx, edx
+    this->emit({0x45, 0x31, 0xC0});             // xor r8d, r8d
+
+    if (iterations > 0) {
+        this->emit({0x41, 0xB9});               // mov r9d, iterations
+        this->emit32(iterations);
+        size_t loop = this->code_.size();
+        for (int j = 0; j != unroll; ++j) {
+            this->emit_add_load(j % 4, (long) j * stride * 4);
+        }
+        this->emit({0x48, 0x81, 0xC7});         // add rdi, unroll*stride*4
+        this->emit32(unroll * stride * 4);
+        this->emit({0x41, 0xFF, 0xC9});         // dec r9d
+        this->emit({0x0F, 0x85});               // jnz loop
+        this->emit32(loop - (this->code_.size() + 4));
+    }
+    for (long j = 0; j != leftover; ++j) {
+        this->emit_add_load(j % 4, j * stride * 4);
+    }
+
+    this->emit({0x01, 0xC8});                   // add eax, ecx
+    this->emit({0x01, 0xD0});                   // add eax, edx
+    this->emit({0x44, 0x01, 0xC0});             // add eax, r8d
+    this->emit({0xC3});                         // ret
+
+    this->mem_size_ = this->code_.size();
+    this->mem_ = mmap(nullptr, this->mem_size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (this->mem_ == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    memcpy(this->mem_, this->code_.data(), this->code_.size());
+    allow_execute(this->mem_, this->mem_size_);
+    this->f_ = (jit_sum_function) this->mem_;
+#else
+    (void) n, (void) stride, (void) unroll;
+#endif
+}
+
+jit_sum::~jit_sum() {
+    if (this->mem_) {
+        munmap(this->mem_, this->mem_size_);
+    }
+}
+
+void jit_sum::emit(std::initializer_list<unsigned char> bytes) {
+    this->code_.insert(this->code_.end(), bytes);
+}
+
+void jit_sum::emit32(unsigned x) {
+    this->emit({(unsigned char) x, (unsigned char) (x >> 8),
+                (unsigned char) (x >> 16), (unsigned char) (x >> 24)});
+}
+
+// Emit `add ACC, [rdi + disp]` for accumulator `acc` (0-3). Small
+// displacements use the 1-byte form.
+void jit_sum::emit_add_load(int acc, long disp) {
+    static const unsigned char reg[] = {0, 1, 2, 0};   // eax ecx edx r8d
+    if (acc == 3) {
+        this->emit({0x44});                     // REX.R
+    }
+    if (disp >= -128 && disp <= 127) {
+        this->emit({0x03, (unsigned char) (0x47 | reg[acc] << 3),
+                    (unsigned char) disp});
+    } else {
+        this->emit({0x03, (unsigned char) (0x87 | reg[acc] << 3)});
+        this->emit32(disp);
+    }
+}
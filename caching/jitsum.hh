@@ -0,0 +1,52 @@
+#ifndef JITSUM_HH
+#define JITSUM_HH
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+// jit_sum
+//    Generate x86-64 machine code, at runtime, for a kernel that returns
+//    the sum (mod 2^32) of `data[0]`, `data[stride]`, `data[2*stride]`,
+//    ... for every index less than `n`.
+//
+//    The compiled loop `for (i = 0; i < n; i += stride) sum += data[i]`
+//    must keep `n` and `stride` in registers, increment an index, and
+//    compare it against `n` on every element. The generated kernel instead
+//    bakes them into the instructions: it is unrolled `unroll` times, each
+//    load `add r32, [rdi + j*stride*4]` carries its offset as a
+//    displacement, the loop runs a precomputed iteration count, and the
+//    leftover elements are straight-line code. Four accumulators rotate
+//    to break the dependence chain through `sum`.
+//
+//    The code lives in memory made executable with `allow_execute`. Returns
+//    nullptr on non-x86-64 machines or if `stride * unroll` is too large
+//    for a 32-bit displacement.
+
+typedef unsigned (*jit_sum_function)(const int* data);
+
+struct jit_sum {
+    jit_sum(int n, int stride, int unroll = 8);
+    ~jit_sum();
+    jit_sum(const jit_sum&) = delete;
+    jit_sum& operator=(const jit_sum&) = delete;
+
+    jit_sum_function function() const {
+        return this->f_;
+    }
+    // Return the number of bytes of generated code.
+    size_t code_size() const {
+        return this->code_.size();
+    }
+
+  private:
+    std::vector<unsigned char> code_;
+    void* mem_ = nullptr;
+    size_t mem_size_ = 0;
+    jit_sum_function f_ = nullptr;
+
+    void emit(std::initializer_list<unsigned char> bytes);
+    void emit32(unsigned x);
+    void emit_add_load(int acc, long disp);
+};
+
+#endif
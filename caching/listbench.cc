@@ -0,0 +1,95 @@
+#include "qslib.hh"
+#include "allowexec.hh"
+
+// Usage: ./listbench [-i REPEATS] [SIZE]
+//    Compare containers of SIZE integers (default 1000000): `std::vector`,
+//    `std::list` with nodes allocated in order, `pool_list`,
+//    `chunked_list`, and `std::list` with nodes linked in random memory
+//    order (as in a long-lived, fragmented heap). For each it reports nanoseconds per
+//    element to build the container with `push_back`, to traverse it with
+//    `ints_checksum` (averaged over REPEATS traversals, default 10), and to
+//    `ints_append` two copies of it. Build and append times include
+//    faulting in fresh memory.
+
+template <typename T>
+static T build(int n) {
+    T x;
+    for (int i = 0; i < n; ++i) {
+        x.push_back(i);
+    }
+    return x;
+}
+
+// Return a `std::list` holding 0..n-1 whose nodes are linked in random
+// address order.
+static std::list<int> build_shuffled(int n) {
+    std::list<int> x = build<std::list<int>>(n);
+    std::vector<std::list<int>::iterator> nodes;
+    for (auto it = x.begin(); it != x.end(); ++it) {
+        nodes.push_back(it);
+    }
+    for (int i = n - 1; i > 0; --i) {
+        std::swap(nodes[i], nodes[random() % (i + 1)]);
+    }
+    // relink the nodes in shuffled order, then write values in list order
+    std::list<int> y;
+    for (auto it : nodes) {
+        y.splice(y.end(), x, it);
+    }
+    int v = 0;
+    for (auto& e : y) {
+        e = v++;
+    }
+    return y;
+}
+
+template <typename T, typename B>
+static void bench(const char* name, B make, int n, unsigned repeats) {
+    unsigned expected = (unsigned) ((unsigned long) n * (n - 1) / 2);
+
+    double start = tstamp();
+    T x = make(n);
+    double build_time = tstamp() - start;
+
+    start = tstamp();
+    for (unsigned r = 0; r != repeats; ++r) {
+        unsigned sum = ints_checksum(x);
+        assert(sum == expected);
+    }
+    double traverse_time = (tstamp() - start) / repeats;
+
+    start = tstamp();
+    T y = ints_append(x, x);
+    double append_time = tstamp() - start;
+    assert(y.size() == 2 * x.size() && ints_checksum(y) == 2 * expected);
+
+    printf("%-18s %10.3f %10.3f %10.3f\n", name, build_time * 1e9 / n,
+           traverse_time * 1e9 / n, append_time * 1e9 / (2 * n));
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    int n = 1000000;
+    unsigned repeats = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc
+            && strisnumber(argv[i + 1]) && atoi(argv[i + 1]) > 0) {
+            repeats = strtoul(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strisnumber(argv[i]) && strtol(argv[i], NULL, 0) > 0) {
+            n = strtol(argv[i], NULL, 0);
+        } else {
+            fprintf(stderr, "Usage: %s [-i REPEATS] [SIZE]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    printf("%d integers   (ns/element)\n", n);
+    printf("%-18s %10s %10s %10s\n", "container", "build", "traverse", "append");
+    bench<std::vector<int>>("std::vector", build<std::vector<int>>, n, repeats);
+    bench<std::list<int>>("std::list", build<std::list<int>>, n, repeats);
+    bench<pool_list>("pool_list", build<pool_list>, n, repeats);
+    bench<chunked_list>("chunked_list", build<chunked_list>, n, repeats);
+    // last, because freeing its scattered nodes slows later allocations
+    bench<std::list<int>>("std::list shuffled", build_shuffled, n, repeats);
+}
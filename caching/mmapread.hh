@@ -0,0 +1,94 @@
+#ifndef MMAPREAD_HH
+#define MMAPREAD_HH
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+// mmap_file
+//    A read-only memory mapping of a whole file. Readers access the file's
+//    bytes directly through `data`, with no copy into a user buffer.
+
+struct mmap_file {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+};
+
+// mmap_open(fd, size, advice, hugepage)
+//    Map the first `size` bytes of `fd` and pass `advice` (MADV_SEQUENTIAL,
+//    MADV_WILLNEED, ...) to `madvise`. If `hugepage` is true, the mapping
+//    is also advised MADV_HUGEPAGE, which lets the kernel use 2 MiB pages
+//    for files on filesystems that support them (e.g. tmpfs with
+//    `huge=advise`). Returns a mapping with `data == nullptr` on error.
+
+inline mmap_file mmap_open(int fd, size_t size, int advice, bool hugepage) {
+    mmap_file mf;
+    if (size == 0) {
+        return mf;
+    }
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        return mf;
+    }
+    if (advice != MADV_NORMAL && madvise(p, size, advice) != 0) {
+        perror("madvise");
+    }
+#ifdef MADV_HUGEPAGE
+    if (hugepage && madvise(p, size, MADV_HUGEPAGE) != 0) {
+        perror("madvise(MADV_HUGEPAGE)");
+    }
+#else
+    (void) hugepage;
+#endif
+    mf.data = (const unsigned char*) p;
+    mf.size = size;
+    return mf;
+}
+
+inline void mmap_close(mmap_file& mf) {
+    if (mf.data) {
+        munmap((void*) mf.data, mf.size);
+        mf.data = nullptr;
+    }
+}
+
+// mapping_huge_kb(addr)
+//    Return the number of kilobytes of the mapping containing `addr` that
+//    are currently backed by huge pages (transparent or hugetlbfs),
+//    according to /proc/self/smaps. Returns -1 if that information is
+//    unavailable.
+
+inline long mapping_huge_kb(const void* addr) {
+    FILE* f = fopen("/proc/self/smaps", "r");
+    if (!f) {
+        return -1;
+    }
+    uintptr_t a = (uintptr_t) addr;
+    char line[512];
+    bool in_mapping = false;
+    long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        uintptr_t start, end;
+        long value;
+        char name[64];
+        if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR, &start, &end) == 2) {
+            if (in_mapping) {
+                break;
+            }
+            in_mapping = start <= a && a < end;
+        } else if (in_mapping
+                   && sscanf(line, "%63[^:]: %ld kB", name, &value) == 2
+                   && (strcmp(name, "AnonHugePages") == 0
+                       || strcmp(name, "FilePmdMapped") == 0
+                       || strcmp(name, "ShmemPmdMapped") == 0
+                       || strcmp(name, "Private_Hugetlb") == 0
+                       || strcmp(name, "Shared_Hugetlb") == 0)) {
+            kb = (kb < 0 ? 0 : kb) + value;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include "perfcounters.hh"
+#include <cstring>
+#include <cerrno>
+#include <cinttypes>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static const struct {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+} perf_events[perf_nevents] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"L1-dcache-load-misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"LLC-load-misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"dTLB-load-misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+};
+
+static int perf_open(int e, bool user_only) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[e].type;
+    attr.config = perf_events[e].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+perf_counters::perf_counters() {
+    for (int e = 0; e != perf_nevents; ++e) {
+        this->value_[e] = this->enabled_[e] = this->running_[e] = 0;
+        this->fd_[e] = perf_open(e, this->user_only_);
+        if (this->fd_[e] < 0 && (errno == EACCES || errno == EPERM)
+            && !this->user_only_) {
+            // not allowed to count the kernel: count user code only
+            this->user_only_ = true;
+            for (int i = 0; i != e; ++i) {
+                if (this->fd_[i] >= 0) {
+                    close(this->fd_[i]);
+                    this->fd_[i] = perf_open(i, true);
+                }
+            }
+            this->fd_[e] = perf_open(e, true);
+        }
+        if (this->fd_[e] < 0 && this->errno_ == 0) {
+            this->errno_ = errno;
+        }
+    }
+}
+
+perf_counters::~perf_counters() {
+    for (int e = 0; e != perf_nevents; ++e) {
+        if (this->fd_[e] >= 0) {
+            close(this->fd_[e]);
+        }
+    }
+}
+
+const char* perf_counters::name(perf_event_id e) {
+    return perf_events[e].name;
+}
+
+void perf_counters::start() {
+    // PERF_EVENT_IOC_RESET clears the count but not the enabled and
+    // running times, so remember those to scale by this window's share
+    for (int e = 0; e != perf_nevents; ++e) {
+        uint64_t v[3];          // value, time enabled, time running
+        this->enabled_[e] = this->running_[e] = 0;
+        if (this->fd_[e] >= 0) {
+            ioctl(this->fd_[e], PERF_EVENT_IOC_RESET, 0);
+            if (read(this->fd_[e], v, sizeof(v)) == (ssize_t) sizeof(v)) {
+                this->enabled_[e] = v[1];
+                this->running_[e] = v[2];
+            }
+        }
+    }
+    for (int e = 0; e != perf_nevents; ++e) {
+        if (this->fd_[e] >= 0) {
+            ioctl(this->fd_[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void perf_counters::stop() {
+    for (int e = 0; e != perf_nevents; ++e) {
+        if (this->fd_[e] >= 0) {
+            ioctl(this->fd_[e], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int e = 0; e != perf_nevents; ++e) {
+        uint64_t v[3];          // value, time enabled, time running
+        this->value_[e] = 0;
+        if (this->fd_[e] >= 0
+            && read(this->fd_[e], v, sizeof(v)) == (ssize_t) sizeof(v)) {
+            uint64_t enabled = v[1] - this->enabled_[e];
+            uint64_t running = v[2] - this->running_[e];
+            if (running != 0) {
+                this->value_[e] = running < enabled
+                    ? v[0] * ((double) enabled / running) : v[0];
+            }
+        }
+    }
+}
+
+void perf_counters::print(FILE* out, uint64_t nops) const {
+    int navailable = 0;
+    for (int e = 0; e != perf_nevents; ++e) {
+        if (this->fd_[e] < 0) {
+            continue;
+        }
+        fprintf(out, "perf: %20s %14" PRIu64, perf_events[e].name,
+                this->value_[e]);
+        if (nops) {
+            fprintf(out, "   %10.3f/op", this->value_[e] / (double) nops);
+        }
+        if (e == perf_instructions && this->fd_[perf_cycles] >= 0
+            && this->value_[perf_cycles] != 0) {
+            fprintf(out, "   %.2f IPC",
+                    this->value_[e] / (double) this->value_[perf_cycles]);
+        }
+        fprintf(out, "\n");
+        ++navailable;
+    }
+    if (navailable != perf_nevents) {
+        fprintf(out, "perf: unavailable:");
+        for (int e = 0; e != perf_nevents; ++e) {
+            if (this->fd_[e] < 0) {
+                fprintf(out, " %s", perf_events[e].name);
+            }
+        }
+        fprintf(out, " (%s)\n", strerror(this->errno_));
+    }
+    if (navailable != 0 && this->user_only_) {
+        fprintf(out, "perf: counting user code only\n");
+    }
+}
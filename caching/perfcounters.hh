@@ -0,0 +1,63 @@
+#ifndef PERFCOUNTERS_HH
+#define PERFCOUNTERS_HH
+#include <cstdio>
+#include <cstdint>
+
+// perf_counters
+//    Hardware event counters for a region of this process, read with
+//    `perf_event_open`. Unlike `perf stat` (see perf.sh), the counts cover
+//    only the code between `start()` and `stop()`, not setup work like
+//    array initialization.
+//
+//    Counters that can't be opened (no PMU in a virtual machine,
+//    `kernel.perf_event_paranoid` too high, event not supported by the CPU)
+//    are reported as unavailable; the benchmark runs regardless. The
+//    page-fault count is a software event, so it is usually available even
+//    where hardware counters are not. If
+//    counting kernel code isn't permitted, only user code is counted.
+//    Counts are scaled to make up for multiplexing when more events are
+//    requested than the CPU has counters.
+
+enum perf_event_id {
+    perf_cycles, perf_instructions, perf_cache_references, perf_cache_misses,
+    perf_l1d_misses, perf_llc_misses, perf_dtlb_misses, perf_page_faults,
+    perf_nevents
+};
+
+struct perf_counters {
+    perf_counters();
+    ~perf_counters();
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    // Reset and start counting.
+    void start();
+    // Stop counting and read the counters.
+    void stop();
+
+    // Return true if event `e` is being counted.
+    bool available(perf_event_id e) const {
+        return this->fd_[e] >= 0;
+    }
+    // Return the count of event `e` between the last `start()` and
+    // `stop()`, or 0 if `e` is unavailable.
+    uint64_t value(perf_event_id e) const {
+        return this->value_[e];
+    }
+    // Return the short name of event `e` (e.g. "LLC-load-misses").
+    static const char* name(perf_event_id e);
+
+    // Print the counts to `out`, dividing by `nops` (if nonzero) to show
+    // counts per operation as well.
+    void print(FILE* out, uint64_t nops = 0) const;
+
+  private:
+    int fd_[perf_nevents];
+    uint64_t value_[perf_nevents];
+    uint64_t enabled_[perf_nevents];    // time enabled at `start()`
+    uint64_t running_[perf_nevents];    // time running at `start()`
+    bool user_only_ = false;
+    int errno_ = 0;             // error from the first failed open
+};
+
+#endif
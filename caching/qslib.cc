@@ -1,5 +1,9 @@
 #include "qslib.hh"
 #include "allowexec.hh"
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 void initialize_random(int* array, int n) {
     for (int i = 0; i < n; ++i) {
@@ -31,36 +35,315 @@ void initialize_magic(int* array, int n) {
     }
 }
 
-void ints_print(const int* array, int n) {
-    printf("[");
-    for (int i = 0; i < n && i < 20; ++i) {
-        printf(i ? ", %d" : "%d", array[i]);
+// initialize_strided(array, n, stride)
+//    Visit every `stride`-th index starting at 0, then every `stride`-th
+//    index starting at 1, and so on, until every index has been visited.
+void initialize_strided(int* array, int n, int stride) {
+    int k = 0;
+    for (int start = 0; start < stride && start < n; ++start) {
+        for (long i = start; i < n; i += stride) {
+            array[k] = i;
+            ++k;
+        }
     }
-    if (n > 20) {
-        printf(", ...");
+}
+
+// initialize_blocked(array, n, tile)
+//    Visit tiles of `tile` consecutive indexes in order, but visit the
+//    indexes within each tile in random order. A tile of 16 ints is a cache
+//    line; a tile of 1024 ints is a 4 KiB page.
+void initialize_blocked(int* array, int n, int tile) {
+    for (int t = 0; t < n; t += tile) {
+        int m = std::min(tile, n - t);
+        for (int i = 0; i < m; ++i) {
+            array[t + i] = t + i;
+        }
+        for (int i = 0; i < m; ++i) {
+            std::swap(array[t + i], array[t + random() % m]);
+        }
     }
-    printf("]\n");
 }
 
-void ints_print(const std::list<int>& list) {
-    printf("[");
-    auto it = list.begin();
-    for (int i = 0; it != list.end() && i < 20; ++i, ++it) {
-        printf(i ? ", %d" : "%d", *it);
+// Zipf sampling by rejection-inversion (Hörmann & Derflinger 1996), which
+// needs constant space however many elements there are.
+static double zipf_helper1(double x) {
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+static double zipf_helper2(double x) {
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+static double zipf_h(double x, double skew) {
+    return exp(-skew * log(x));
+}
+
+static double zipf_hintegral(double x, double skew) {
+    double logx = log(x);
+    return zipf_helper2((1 - skew) * logx) * logx;
+}
+
+static double zipf_hintegral_inverse(double x, double skew) {
+    double t = std::max(x * (1 - skew), -1.0);
+    return exp(zipf_helper1(t) * x);
+}
+
+// initialize_zipf(array, n, skew)
+//    Fill `array` with `n` indexes drawn from a Zipf distribution with
+//    exponent `skew`: the `k`th most popular index is drawn with probability
+//    proportional to 1/k^skew. Popular indexes are scattered randomly
+//    through [0, n), so the hot set is not contiguous. Unlike the other
+//    patterns, this one repeats some indexes and omits others.
+void initialize_zipf(int* array, int n, double skew) {
+    std::vector<int> rank(n);
+    initialize_random(rank.data(), n);
+
+    double hx1 = zipf_hintegral(1.5, skew) - 1;
+    double hn = zipf_hintegral(n + 0.5, skew);
+    double s = 2 - zipf_hintegral_inverse(zipf_hintegral(2.5, skew)
+                                          - zipf_h(2, skew), skew);
+    for (int i = 0; i < n; ++i) {
+        long k;
+        while (true) {
+            double u = hn + (random() + 0.5) / 2147483648.0 * (hx1 - hn);
+            double x = zipf_hintegral_inverse(u, skew);
+            k = std::min(std::max((long) (x + 0.5), 1L), (long) n);
+            if (k - x <= s
+                || u >= zipf_hintegral(k + 0.5, skew) - zipf_h(k, skew)) {
+                break;
+            }
+        }
+        array[i] = rank[k - 1];
     }
-    if (it != list.end()) {
-        printf(", ...");
+}
+
+// initialize_chase(array, n)
+//    Make `array` a random cyclic permutation (Sattolo's algorithm):
+//    following `i = array[i]` from any index visits every index once before
+//    returning to the start. Each index is a pointer to the next, so a
+//    benchmark that follows the chain cannot overlap its loads.
+void initialize_chase(int* array, int n) {
+    for (int i = 0; i < n; ++i) {
+        array[i] = i;
     }
-    printf("]\n");
+    for (int i = n - 1; i > 0; --i) {
+        std::swap(array[i], array[random() % i]);
+    }
+}
+
+
+// SIMD checksum and sortedness kernels
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+#else
+#define NO_VECTORIZE
+#endif
+
+NO_VECTORIZE static unsigned checksum_scalar(const int* array, int n) {
+    unsigned sum = 0;
+#ifdef __clang__
+#pragma clang loop vectorize(disable)
+#endif
+    for (int i = 0; i != n; ++i) {
+        sum += (unsigned) array[i];
+    }
+    return sum;
+}
+
+static bool sorted_scalar(const int* array, int n) {
+    for (int i = 0; i < n - 1; ++i) {
+        if (array[i] > array[i + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Each kernel handles whole vectors with four independent accumulators
+// (so additions overlap) and leaves the tail to the scalar loop.
+
+static unsigned checksum_sse2(const int* array, int n) {
+    __m128i s0 = _mm_setzero_si128(), s1 = s0, s2 = s0, s3 = s0;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i* p = (const __m128i*) &array[i];
+        s0 = _mm_add_epi32(s0, _mm_loadu_si128(p));
+        s1 = _mm_add_epi32(s1, _mm_loadu_si128(p + 1));
+        s2 = _mm_add_epi32(s2, _mm_loadu_si128(p + 2));
+        s3 = _mm_add_epi32(s3, _mm_loadu_si128(p + 3));
+    }
+    __m128i s = _mm_add_epi32(_mm_add_epi32(s0, s1), _mm_add_epi32(s2, s3));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (unsigned) _mm_cvtsi128_si32(s) + checksum_scalar(&array[i], n - i);
+}
+
+// `array` is sorted iff no element is greater than its successor: compare
+// each vector with the same vector shifted by one element.
+static bool sorted_sse2(const int* array, int n) {
+    int i = 0;
+    for (; i + 17 <= n; i += 16) {
+        __m128i bad = _mm_setzero_si128();
+        for (int j = 0; j != 16; j += 4) {
+            __m128i a = _mm_loadu_si128((const __m128i*) &array[i + j]);
+            __m128i b = _mm_loadu_si128((const __m128i*) &array[i + j + 1]);
+            bad = _mm_or_si128(bad, _mm_cmpgt_epi32(a, b));
+        }
+        if (_mm_movemask_epi8(bad)) {
+            return false;
+        }
+    }
+    return sorted_scalar(&array[i], n - i);
+}
+
+__attribute__((target("avx2")))
+static unsigned checksum_avx2(const int* array, int n) {
+    __m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i* p = (const __m256i*) &array[i];
+        s0 = _mm256_add_epi32(s0, _mm256_loadu_si256(p));
+        s1 = _mm256_add_epi32(s1, _mm256_loadu_si256(p + 1));
+        s2 = _mm256_add_epi32(s2, _mm256_loadu_si256(p + 2));
+        s3 = _mm256_add_epi32(s3, _mm256_loadu_si256(p + 3));
+    }
+    __m256i s = _mm256_add_epi32(_mm256_add_epi32(s0, s1),
+                                 _mm256_add_epi32(s2, s3));
+    __m128i h = _mm_add_epi32(_mm256_castsi256_si128(s),
+                              _mm256_extracti128_si256(s, 1));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (unsigned) _mm_cvtsi128_si32(h) + checksum_scalar(&array[i], n - i);
+}
+
+__attribute__((target("avx2")))
+static bool sorted_avx2(const int* array, int n) {
+    int i = 0;
+    for (; i + 33 <= n; i += 32) {
+        __m256i bad = _mm256_setzero_si256();
+        for (int j = 0; j != 32; j += 8) {
+            __m256i a = _mm256_loadu_si256((const __m256i*) &array[i + j]);
+            __m256i b = _mm256_loadu_si256((const __m256i*) &array[i + j + 1]);
+            bad = _mm256_or_si256(bad, _mm256_cmpgt_epi32(a, b));
+        }
+        if (!_mm256_testz_si256(bad, bad)) {
+            return false;
+        }
+    }
+    return sorted_scalar(&array[i], n - i);
+}
+
+__attribute__((target("avx512f")))
+static unsigned checksum_avx512(const int* array, int n) {
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0, s2 = s0, s3 = s0;
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        s0 = _mm512_add_epi32(s0, _mm512_loadu_si512(&array[i]));
+        s1 = _mm512_add_epi32(s1, _mm512_loadu_si512(&array[i + 16]));
+        s2 = _mm512_add_epi32(s2, _mm512_loadu_si512(&array[i + 32]));
+        s3 = _mm512_add_epi32(s3, _mm512_loadu_si512(&array[i + 48]));
+    }
+    __m512i s = _mm512_add_epi32(_mm512_add_epi32(s0, s1),
+                                 _mm512_add_epi32(s2, s3));
+    unsigned lanes[16];
+    _mm512_storeu_si512(lanes, s);
+    return checksum_scalar((const int*) lanes, 16)
+        + checksum_scalar(&array[i], n - i);
+}
+
+__attribute__((target("avx512f")))
+static bool sorted_avx512(const int* array, int n) {
+    int i = 0;
+    for (; i + 65 <= n; i += 64) {
+        __mmask16 bad = 0;
+        for (int j = 0; j != 64; j += 16) {
+            __m512i a = _mm512_loadu_si512(&array[i + j]);
+            __m512i b = _mm512_loadu_si512(&array[i + j + 1]);
+            bad |= _mm512_cmpgt_epi32_mask(a, b);
+        }
+        if (bad) {
+            return false;
+        }
+    }
+    return sorted_scalar(&array[i], n - i);
+}
+#endif
+
+// Return a bitmask of the supported instruction sets (checked once), so
+// the kernels' `assert`s cost a load rather than a CPUID query.
+static unsigned ints_isa_mask() {
+#if defined(__x86_64__) || defined(__i386__)
+    static unsigned mask = (__builtin_cpu_init(), 1U << isa_scalar)
+        | (__builtin_cpu_supports("sse2") ? 1U << isa_sse2 : 0)
+        | (__builtin_cpu_supports("avx2") ? 1U << isa_avx2 : 0)
+        | (__builtin_cpu_supports("avx512f") ? 1U << isa_avx512 : 0);
+    return mask;
+#else
+    return 1U << isa_scalar;
+#endif
+}
+
+bool ints_isa_supported(ints_isa isa) {
+    return (ints_isa_mask() >> isa) & 1;
 }
 
-void ints_print(const std::vector<int>& list) {
+const char* ints_isa_name(ints_isa isa) {
+    static const char* const names[] = {"scalar", "sse2", "avx2", "avx512"};
+    return names[isa];
+}
+
+unsigned ints_checksum_isa(ints_isa isa, const int* array, int n) {
+    assert(ints_isa_supported(isa));
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == isa_avx512) {
+        return checksum_avx512(array, n);
+    } else if (isa == isa_avx2) {
+        return checksum_avx2(array, n);
+    } else if (isa == isa_sse2) {
+        return checksum_sse2(array, n);
+    }
+#endif
+    return checksum_scalar(array, n);
+}
+
+bool ints_sorted_isa(ints_isa isa, const int* array, int n) {
+    assert(ints_isa_supported(isa));
+#if defined(__x86_64__) || defined(__i386__)
+    if (isa == isa_avx512) {
+        return sorted_avx512(array, n);
+    } else if (isa == isa_avx2) {
+        return sorted_avx2(array, n);
+    } else if (isa == isa_sse2) {
+        return sorted_sse2(array, n);
+    }
+#endif
+    return sorted_scalar(array, n);
+}
+
+// Return the best supported instruction set (checked once).
+static ints_isa ints_best_isa() {
+    static ints_isa best = ints_isa_supported(isa_avx512) ? isa_avx512
+        : ints_isa_supported(isa_avx2) ? isa_avx2
+        : ints_isa_supported(isa_sse2) ? isa_sse2 : isa_scalar;
+    return best;
+}
+
+unsigned ints_checksum(const int* array, int n) {
+    return ints_checksum_isa(ints_best_isa(), array, n);
+}
+
+bool ints_sorted(const int* array, int n) {
+    return ints_sorted_isa(ints_best_isa(), array, n);
+}
+
+void ints_print(const int* array, int n) {
     printf("[");
-    auto it = list.begin();
-    for (int i = 0; it != list.end() && i < 20; ++i, ++it) {
-        printf(i ? ", %d" : "%d", *it);
+    for (int i = 0; i < n && i < 20; ++i) {
+        printf(i ? ", %d" : "%d", array[i]);
     }
-    if (it != list.end()) {
+    if (n > 20) {
         printf(", ...");
     }
     printf("]\n");
@@ -73,17 +356,49 @@ qs_info parse_arguments(int argc, char** argv) {
     qsi.size = 6;
     qsi.execute = true;
     qsi.repeats = 1;
+    qsi.counters = false;
+    qsi.prefetch = 0;
+    qsi.gather = false;
 
     // parse command line arguments
     int initialize_type = 'r';
+    long param = 0;
+    double skew = 0.99;
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "-r") == 0
             || strcmp(argv[i], "-u") == 0
             || strcmp(argv[i], "-d") == 0
-            || strcmp(argv[i], "-m") == 0) {
+            || strcmp(argv[i], "-m") == 0
+            || strcmp(argv[i], "-c") == 0) {
             initialize_type = argv[i][1];
+        } else if ((strcmp(argv[i], "-s") == 0
+                    || strcmp(argv[i], "-b") == 0)
+                   && i + 1 < argc && strisnumber(argv[i + 1])) {
+            initialize_type = argv[i][1];
+            param = strtol(argv[i + 1], NULL, 0);
+            assert(param > 0);
+            ++i;
+        } else if (strcmp(argv[i], "-z") == 0
+                   && i + 1 < argc && strtod(argv[i + 1], NULL) > 0) {
+            initialize_type = 'z';
+            skew = strtod(argv[i + 1], NULL);
+            ++i;
         } else if (strcmp(argv[i], "-d") == 0) {
             qsi.execute = false;
+        } else if (strcmp(argv[i], "-e") == 0) {
+            qsi.counters = true;
+        } else if (strcmp(argv[i], "-p") == 0
+                   && i + 1 < argc && strisnumber(argv[i + 1])) {
+            qsi.prefetch = strtol(argv[i + 1], NULL, 0);
+            ++i;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            qsi.gather = true;
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc
+                   && parse_huge_mode(argv[i + 1], qsi.alloc)) {
+            ++i;
+        } else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc
+                   && parse_numa_mode(argv[i + 1], qsi.alloc)) {
+            ++i;
         } else if (strcmp(argv[i], "-i") == 0) {
             qsi.repeats = strtol(argv[i + 1], NULL, 0);
             ++i;
@@ -91,13 +406,15 @@ qs_info parse_arguments(int argc, char** argv) {
             qsi.size = strtol(argv[i], NULL, 0);
             assert(qsi.size > 0);
         } else {
-            fprintf(stderr, "Usage: %s [-r|-u|-d|-m] [-i REPEATS] [-d] [SIZE]\n", argv[0]);
+            fprintf(stderr, "Usage: %s [-r|-u|-d|-m|-c|-s STRIDE|-b TILE|-z SKEW] [-i REPEATS] [-d] [-e] [-p DISTANCE] [-g] [-H none|thp|hugetlb] [-N NODE|interleave] [SIZE]\n", argv[0]);
             exit(1);
         }
     }
 
     // initialize based on command line argument
-    qsi.array = new int[qsi.size];
+    static char pattern[64];
+    qsi.array_mem = big_alloc(qsi.size * sizeof(int), qsi.alloc);
+    qsi.array = (int*) qsi.array_mem.ptr;
     if (initialize_type == 'r') {
         initialize_random(qsi.array, qsi.size);
         qsi.pattern = "random";
@@ -110,6 +427,21 @@ qs_info parse_arguments(int argc, char** argv) {
     } else if (initialize_type == 'm') {
         initialize_magic(qsi.array, qsi.size);
         qsi.pattern = "magic";
+    } else if (initialize_type == 's') {
+        initialize_strided(qsi.array, qsi.size, param);
+        snprintf(pattern, sizeof(pattern), "stride-%ld", param);
+        qsi.pattern = pattern;
+    } else if (initialize_type == 'b') {
+        initialize_blocked(qsi.array, qsi.size, param);
+        snprintf(pattern, sizeof(pattern), "blocked-random (tile %ld)", param);
+        qsi.pattern = pattern;
+    } else if (initialize_type == 'z') {
+        initialize_zipf(qsi.array, qsi.size, skew);
+        snprintf(pattern, sizeof(pattern), "zipf (skew %g)", skew);
+        qsi.pattern = pattern;
+    } else if (initialize_type == 'c') {
+        initialize_chase(qsi.array, qsi.size);
+        qsi.pattern = "pointer-chase";
     }
 
     qsi.checksum = ints_checksum(qsi.array, qsi.size);
@@ -9,6 +9,11 @@
 #include <vector>
 #include <algorithm>
 #include <iterator>
+#include <type_traits>
+#include "intlist.hh"
+#include "intset.hh"
+#include "hugealloc.hh"
+#include "../common/hrtime.hh"
 
 struct qs_info {
     int* array;
@@ -17,31 +22,56 @@ struct qs_info {
     bool execute;
     unsigned checksum;
     unsigned repeats;
+    bool counters;
+    int prefetch;               // software prefetch distance (`-p`), or 0
+    bool gather;                // also time an AVX2 gather loop (`-g`)
+    alloc_options alloc;        // page size and NUMA placement (`-H`, `-N`)
+    big_array array_mem;        // memory backing `array`
 };
 qs_info parse_arguments(int argc, char** argv);
 
 
-inline unsigned ints_checksum(const int* array, int n) {
-    unsigned sum = 0;
-    for (int i = 0; i != n; ++i) {
-        sum += (unsigned) array[i];
-    }
-    return sum;
-}
+// ints_checksum(array, n), ints_sorted(array, n)
+//    Return the sum of `array[0..n)` (mod 2^32), and whether the array is
+//    in nondecreasing order. These use the widest SIMD instructions the CPU
+//    supports (AVX-512, AVX2, or SSE2), chosen at runtime.
+unsigned ints_checksum(const int* array, int n);
+bool ints_sorted(const int* array, int n);
 
-inline bool ints_sorted(const int* array, int n) {
-    for (int i = 0; i < n - 1; ++i) {
-        if (array[i] > array[i + 1]) {
-            return false;
-        }
-    }
-    return true;
-}
+// Instruction sets for `ints_checksum_isa` and `ints_sorted_isa`, which
+// let benchmarks compare the kernels. `isa_scalar` is a plain loop
+// compiled without auto-vectorization.
+enum ints_isa {
+    isa_scalar, isa_sse2, isa_avx2, isa_avx512
+};
+bool ints_isa_supported(ints_isa isa);
+const char* ints_isa_name(ints_isa isa);
+unsigned ints_checksum_isa(ints_isa isa, const int* array, int n);
+bool ints_sorted_isa(ints_isa isa, const int* array, int n);
 
 void ints_print(const int* array, int n);
 
+// ints_print(container)
+//    Print the first 20 elements of any container with `begin()` and
+//    `end()`.
+template <typename T>
+auto ints_print(const T& x) -> decltype(x.begin() != x.end(), void()) {
+    printf("[");
+    auto it = x.begin();
+    for (int i = 0; it != x.end() && i < 20; ++i, ++it) {
+        printf(i ? ", %d" : "%d", *it);
+    }
+    if (it != x.end()) {
+        printf(", ...");
+    }
+    printf("]\n");
+}
+
 
-inline unsigned ints_checksum(const std::list<int>& list) {
+// These list versions take any allocator, so they serve both `std::list`
+// and `pool_list` (see intlist.hh).
+template <typename A>
+inline unsigned ints_checksum(const std::list<int, A>& list) {
     unsigned sum = 0;
     for (auto it = list.begin(); it != list.end(); ++it) {
         sum += (unsigned) *it;
@@ -49,7 +79,8 @@ inline unsigned ints_checksum(const std::list<int>& list) {
     return sum;
 }
 
-inline bool ints_sorted(const std::list<int>& list) {
+template <typename A>
+inline bool ints_sorted(const std::list<int, A>& list) {
     if (!list.empty()) {
         auto it = list.begin();
         int last = *it;
@@ -63,58 +94,140 @@ inline bool ints_sorted(const std::list<int>& list) {
     return true;
 }
 
-inline std::list<int> ints_append(const std::list<int>& a,
-                                  const std::list<int>& b) {
-    std::list<int> x;
+template <typename A>
+inline std::list<int, A> ints_append(const std::list<int, A>& a,
+                                     const std::list<int, A>& b) {
+    std::list<int, A> x;
     std::copy(a.begin(), a.end(), std::back_inserter(x));
     std::copy(b.begin(), b.end(), std::back_inserter(x));
     return x;
 }
 
-void ints_print(const std::list<int>& list);
+// The rvalue and in-place variants move nodes with `splice` instead of
+// copying them, so they allocate nothing.
+template <typename A>
+inline std::list<int, A> ints_append(std::list<int, A>&& a,
+                                     std::list<int, A>&& b) {
+    a.splice(a.end(), b);
+    return std::move(a);
+}
+
+template <typename A>
+inline void ints_append_into(std::list<int, A>& dst, std::list<int, A>&& src) {
+    dst.splice(dst.end(), src);
+}
+
+// ints_concat(a, b, c, ...)
+//    Return the concatenation of any number of lists, which must all be
+//    rvalues, by splicing. Allocates nothing.
+template <typename... Ts>
+inline std::list<int> ints_concat(std::list<int>&& a, Ts&&... rest) {
+    static_assert((std::is_same<Ts, std::list<int>>::value && ...),
+                  "ints_concat: pass lists as rvalues (std::move)");
+    (a.splice(a.end(), rest), ...);
+    return std::move(a);
+}
 
 
 inline unsigned ints_checksum(const std::vector<int>& list) {
-    unsigned sum = 0;
-    for (auto it = list.begin(); it != list.end(); ++it) {
-        sum += (unsigned) *it;
-    }
-    return sum;
+    return ints_checksum(list.data(), list.size());
 }
 
 inline bool ints_sorted(const std::vector<int>& list) {
-    if (!list.empty()) {
-        auto it = list.begin();
-        int last = *it;
-        for (++it; it != list.end(); ++it) {
-            if (last > *it) {
-                return false;
-            }
-            last = *it;
-        }
-    }
-    return true;
+    return ints_sorted(list.data(), list.size());
 }
 
 inline std::vector<int> ints_append(const std::vector<int>& a,
                                     const std::vector<int>& b) {
     std::vector<int> x;
-    std::copy(a.begin(), a.end(), std::back_inserter(x));
-    std::copy(b.begin(), b.end(), std::back_inserter(x));
+    x.reserve(a.size() + b.size());
+    x.insert(x.end(), a.begin(), a.end());
+    x.insert(x.end(), b.begin(), b.end());
     return x;
 }
 
+// The rvalue and in-place variants append to an existing buffer, which
+// allocates only if it lacks capacity. `src` must not be `dst`.
+inline std::vector<int> ints_append(std::vector<int>&& a,
+                                    const std::vector<int>& b) {
+    a.insert(a.end(), b.begin(), b.end());
+    return std::move(a);
+}
+
+inline void ints_append_into(std::vector<int>& dst,
+                             const std::vector<int>& src) {
+    dst.insert(dst.end(), src.begin(), src.end());
+}
+
+// ints_concat(a, b, c, ...)
+//    Return the concatenation of any number of vectors, using a single
+//    allocation.
+template <typename... Ts>
+inline std::vector<int> ints_concat(const std::vector<int>& a,
+                                    const Ts&... rest) {
+    std::vector<int> x;
+    x.reserve(a.size() + (rest.size() + ... + 0));
+    x.insert(x.end(), a.begin(), a.end());
+    (x.insert(x.end(), rest.begin(), rest.end()), ...);
+    return x;
+}
+
+
+inline chunked_list ints_append(const chunked_list& a,
+                                const chunked_list& b) {
+    chunked_list x(a);
+    x.append(b);
+    return x;
+}
+
+inline chunked_list ints_append(chunked_list&& a, chunked_list&& b) {
+    a.splice(b);
+    return std::move(a);
+}
+
+inline void ints_append_into(chunked_list& dst, const chunked_list& src) {
+    dst.append(src);
+}
+
+inline void ints_append_into(chunked_list& dst, chunked_list&& src) {
+    dst.splice(src);
+}
+
+
+// ints_checksum(x), ints_sorted(x)
+//    Versions for containers that store their elements in contiguous
+//    chunks visited with `for_each_chunk` (`chunked_list`, `btree_ints`,
+//    `pma_ints`). These run the array kernels on each chunk.
+template <typename T>
+inline auto ints_checksum(const T& x)
+    -> decltype(x.for_each_chunk((void (*)(const int*, int)) nullptr), unsigned()) {
+    unsigned sum = 0;
+    x.for_each_chunk([&] (const int* a, int n) {
+        sum += ints_checksum(a, n);
+    });
+    return sum;
+}
+
+template <typename T>
+inline auto ints_sorted(const T& x)
+    -> decltype(x.for_each_chunk((void (*)(const int*, int)) nullptr), bool()) {
+    bool sorted = true;
+    const int* last = nullptr;
+    x.for_each_chunk([&] (const int* a, int n) {
+        sorted = sorted && ints_sorted(a, n) && (!last || *last <= a[0]);
+        last = &a[n - 1];
+    });
+    return sorted;
+}
+
+
 void initialize_random(int* array, int n);
 void initialize_up(int* array, int n);
 void initialize_down(int* array, int n);
 void initialize_magic(int* array, int n);
-void ints_print(const std::vector<int>& list);
-
-
-inline double timestamp() {
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    return tv.tv_sec + (double) tv.tv_usec * 1e-6;
-}
+void initialize_strided(int* array, int n, int stride);
+void initialize_blocked(int* array, int n, int tile);
+void initialize_zipf(int* array, int n, double skew);
+void initialize_chase(int* array, int n);
 
 #endif
@@ -3,10 +3,31 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include "mmapread.hh"
 
 #define BUFFER_SIZE 16
 
-int main() {
+// Usage: ./read-caching [-M [-H]]
+//    Read test.txt BUFFER_SIZE bytes at a time with `fread`, printing each
+//    chunk. `-M` instead maps the file (advised MADV_SEQUENTIAL) and
+//    prints the same chunks straight from the mapping, with no `fread`
+//    copy; `-H` additionally asks for huge pages (see mmapread.hh).
+
+int main(int argc, char* argv[]) {
+    bool use_mmap = false, hugepage = false;
+    int ch;
+    while ((ch = getopt(argc, argv, "MH")) != -1) {
+	if (ch == 'M') {
+	    use_mmap = true;
+	} else if (ch == 'H') {
+	    hugepage = true;
+	} else {
+	    fprintf(stderr, "Usage: %s [-M [-H]]\n", argv[0]);
+	    exit(1);
+	}
+    }
+
     FILE* fp = fopen("test.txt", "r");
     if (fp == NULL) {
 	perror("Failed to open file");
@@ -14,6 +35,31 @@ int main() {
     }
     printf("Opened fd %d\n", fileno(fp));
 
+    if (use_mmap) {
+	struct stat s;
+	if (fstat(fileno(fp), &s) != 0) {
+	    perror("fstat");
+	    exit(1);
+	}
+	mmap_file mf = mmap_open(fileno(fp), s.st_size, MADV_SEQUENTIAL, hugepage);
+	if (!mf.data && s.st_size > 0) {
+	    perror("mmap");
+	    exit(1);
+	}
+	for (size_t pos = 0; pos < mf.size; pos += BUFFER_SIZE) {
+	    int len = mf.size - pos < BUFFER_SIZE ? mf.size - pos : BUFFER_SIZE;
+	    printf("mmap(%zu) => %2d  buffer:  %.*s\n",
+		   pos, len, len, (const char*) &mf.data[pos]);
+	}
+	long huge_kb = mf.data ? mapping_huge_kb(mf.data) : -1;
+	if (huge_kb >= 0) {
+	    printf("mmap: %ld kB in huge pages\n", huge_kb);
+	}
+	mmap_close(mf);
+	fclose(fp);
+	return 0;
+    }
+
     while(1) {
 	char buffer[BUFFER_SIZE];
 	memset(&buffer, 0, BUFFER_SIZE);
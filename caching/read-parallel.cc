@@ -0,0 +1,141 @@
+#include "iobench.hh"
+#include "allowexec.hh"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Usage: ./read-parallel [-t NTHREADS] [-b CHUNKSIZE] [-i] [FILE]
+//    Read FILE (default test.txt) with NTHREADS threads at once. The file
+//    is split into NTHREADS contiguous ranges, one per thread, and each
+//    thread reads its range with `pread` CHUNKSIZE bytes at a time. With
+//    `-i`, chunks are instead dealt out round-robin (thread `t` reads
+//    chunks `t`, `t + NTHREADS`, ...), so the threads advance through the
+//    file side by side.
+//
+//    The checksum is the sum of all bytes, so it matches `./read`'s
+//    checksum for the same file regardless of thread count.
+
+struct reader_state {
+    unsigned long checksum = 0;
+    size_t n = 0;
+    size_t nsyscalls = 0;
+    double elapsed = 0;
+};
+
+static std::atomic<size_t> nread;
+static std::atomic<size_t> ndone;
+
+static void reader(int fd, off_t start, off_t end, off_t step,
+                   size_t chunksize, reader_state* rs) {
+    unsigned char* buffer = (unsigned char*) malloc(chunksize);
+    double t0 = tstamp();
+    bool eof = false;
+    for (off_t pos = start; pos < end && !eof; pos += step) {
+        size_t want = std::min((off_t) chunksize, end - pos);
+        size_t got = 0;
+        while (got < want) {    // short read: retry the remainder
+            ssize_t bytes_read = pread(fd, buffer + got, want - got, pos + got);
+            ++rs->nsyscalls;
+            if (bytes_read < 0) {
+                perror("pread");
+                exit(1);
+            } else if (bytes_read == 0) {
+                eof = true;
+                break;
+            }
+            got += bytes_read;
+        }
+        for (size_t i = 0; i != got; ++i) {
+            rs->checksum += buffer[i];
+        }
+        rs->n += got;
+        nread += got;
+    }
+    rs->elapsed = tstamp() - t0;
+    ++ndone;
+    free(buffer);
+}
+
+int main(int argc, char* argv[]) {
+    size_t nthreads = 4;
+    size_t chunksize = 65536;
+    bool interleave = false;
+    int ch;
+    while ((ch = getopt(argc, argv, "t:b:i")) != -1) {
+        if (ch == 't' && strisnumber(optarg)) {
+            nthreads = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'b' && strisnumber(optarg)) {
+            chunksize = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'i') {
+            interleave = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-t NTHREADS] [-b CHUNKSIZE] [-i] [FILE]\n", argv[0]);
+            exit(1);
+        }
+    }
+    const char* filename = optind < argc ? argv[optind] : "test.txt";
+    if (nthreads == 0 || chunksize == 0) {
+        fprintf(stderr, "%s: need NTHREADS > 0 and CHUNKSIZE > 0\n", argv[0]);
+        exit(1);
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open file");
+        exit(1);
+    }
+    ssize_t size = filesize(fd);
+    if (size < 0) {
+        fprintf(stderr, "%s: not a regular file\n", filename);
+        exit(1);
+    }
+
+    // contiguous ranges are rounded to whole chunks
+    off_t nchunks = (size + chunksize - 1) / chunksize;
+    off_t per_thread = (nchunks + nthreads - 1) / nthreads * chunksize;
+
+    std::vector<reader_state> rs(nthreads);
+    std::vector<std::thread> th;
+    double start = tstamp();
+    for (size_t t = 0; t != nthreads; ++t) {
+        if (interleave) {
+            th.emplace_back(reader, fd, (off_t) (t * chunksize), (off_t) size,
+                            (off_t) (nthreads * chunksize), chunksize, &rs[t]);
+        } else {
+            off_t lo = std::min((off_t) (t * per_thread), (off_t) size);
+            off_t hi = std::min(lo + per_thread, (off_t) size);
+            th.emplace_back(reader, fd, lo, hi, (off_t) chunksize,
+                            chunksize, &rs[t]);
+        }
+    }
+
+    // report progress while the readers run
+    while (ndone != nthreads) {
+        report(nread, tstamp() - start);
+        usleep(100000);
+    }
+    for (auto& t : th) {
+        t.join();
+    }
+
+    unsigned long checksum = 0;
+    size_t nsyscalls = 0;
+    size_t n = 0;
+    for (auto& r : rs) {
+        checksum += r.checksum;
+        nsyscalls += r.nsyscalls;
+        n += r.n;
+    }
+    report(n, tstamp() - start);
+    fprintf(stderr, "\nchecksum %lu\n", checksum);
+    fprintf(stderr, "%zu threads (%s)   %zu syscalls   %g bytes/syscall\n",
+            nthreads, interleave ? "interleaved" : "ranges",
+            nsyscalls, nsyscalls ? n / (double) nsyscalls : 0.0);
+    for (size_t t = 0; t != nthreads; ++t) {
+        fprintf(stderr, "  thread %zu: %zu bytes   %.3f sec   %g byte/sec\n",
+                t, rs[t].n, rs[t].elapsed,
+                rs[t].elapsed > 0 ? rs[t].n / rs[t].elapsed : 0.0);
+    }
+    close(fd);
+}
@@ -1,31 +1,196 @@
-#include <fcntl.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
+#include "iobench.hh"
+#include "io61.hh"
+#include "mmapread.hh"
+#include "perfcounters.hh"
+#include "allowexec.hh"
+#include <algorithm>
 
 #define BUFFER_SIZE 4
 
-int main() {
-    int fd = open("test.txt", O_RDONLY | O_SYNC);
-    if (fd < 0) { 
-	perror("Failed to open file");
-	exit(1);
+// Usage: ./read [-c [-P POLICY] | -M [-H]] [-b BUFSIZE] [-p seq|rev|stride]
+//               [-s STRIDE] [-T TRACEFILE] [-e] [FILE]
+//    Read FILE (default test.txt) BUFSIZE bytes at a time, with one raw
+//    `read`/`pread` system call per read, or through the io61 read cache
+//    with `-c`. `-P` sets io61's replacement policy (default lru). `-p`
+//    chooses the order in which the file's chunks are read; `-p stride`
+//    reads every STRIDE-th byte offset, then wraps around until the whole
+//    file has been read. STRIDE must be a multiple of BUFSIZE, so the
+//    passes tile the file exactly.
+//
+//    `-M` maps the file with `mmap` and reads it in place, with no copies
+//    and no system calls after setup. The mapping is advised
+//    MADV_SEQUENTIAL for `seq` and `rev` patterns and MADV_WILLNEED for
+//    `stride`. `-H` additionally asks for huge pages.
+//
+//    `-T` writes the offset and size of every read to TRACEFILE, one
+//    `OFFSET SIZE` line per read, for replay by `./cachesim`. `-e` counts
+//    hardware events over the read loop (see perfcounters.hh).
+
+int main(int argc, char* argv[]) {
+    size_t bufsize = BUFFER_SIZE;
+    size_t stride = 4096;
+    const char* pattern = "seq";
+    bool use_cache = false, use_mmap = false, hugepage = false;
+    const char* policy = "lru";
+    const char* tracefile = nullptr;
+    bool counters = false;
+    int ch;
+    while ((ch = getopt(argc, argv, "cP:MHb:p:s:T:e")) != -1) {
+        if (ch == 'c') {
+            use_cache = true;
+        } else if (ch == 'P') {
+            policy = optarg;
+        } else if (ch == 'T') {
+            tracefile = optarg;
+        } else if (ch == 'e') {
+            counters = true;
+        } else if (ch == 'M') {
+            use_mmap = true;
+        } else if (ch == 'H') {
+            hugepage = true;
+        } else if (ch == 'b' && strisnumber(optarg)) {
+            bufsize = strtoul(optarg, nullptr, 0);
+        } else if (ch == 'p' && (strcmp(optarg, "seq") == 0
+                                 || strcmp(optarg, "rev") == 0
+                                 || strcmp(optarg, "stride") == 0)) {
+            pattern = optarg;
+        } else if (ch == 's' && strisnumber(optarg)) {
+            stride = strtoul(optarg, nullptr, 0);
+        } else {
+            fprintf(stderr, "Usage: %s [-c [-P POLICY] | -M [-H]] [-b BUFSIZE] [-p seq|rev|stride] [-s STRIDE] [-T TRACEFILE] [-e] [FILE]\n", argv[0]);
+            exit(1);
+        }
+    }
+    const char* filename = optind < argc ? argv[optind] : "test.txt";
+    if (use_cache && use_mmap) {
+        fprintf(stderr, "%s: -c and -M are exclusive\n", argv[0]);
+        exit(1);
+    }
+    if (bufsize == 0
+        || (strcmp(pattern, "stride") == 0
+            && (stride == 0 || stride % bufsize != 0))) {
+        fprintf(stderr, "%s: need BUFSIZE > 0 and STRIDE a positive multiple of BUFSIZE\n", argv[0]);
+        exit(1);
+    }
+
+    int fd = open(filename, O_RDONLY | O_SYNC);
+    if (fd < 0) {
+        perror("Failed to open file");
+        exit(1);
+    }
+    ssize_t size = filesize(fd);
+    io61_file* f = nullptr;
+    if (use_cache && !(f = io61_fdopen(fd, 4096, 64, 8, policy))) {
+        perror("io61_fdopen");
+        exit(1);
+    }
+    if (size < 0 && (f || use_mmap || strcmp(pattern, "seq") != 0)) {
+        fprintf(stderr, "%s: not a regular file\n", filename);
+        exit(1);
+    }
+    mmap_file mf;
+    if (use_mmap && size > 0) {
+        int advice = strcmp(pattern, "stride") == 0 ? MADV_WILLNEED : MADV_SEQUENTIAL;
+        mf = mmap_open(fd, size, advice, hugepage);
+        if (!mf.data) {
+            perror("mmap");
+            exit(1);
+        }
+    }
+
+    FILE* trace = nullptr;
+    if (tracefile && !(trace = fopen(tracefile, "w"))) {
+        perror(tracefile);
+        exit(1);
+    }
+
+    char* buffer = (char*) malloc(bufsize); // Make a buffer to store part of file
+    unsigned long checksum = 0;
+    size_t n = 0, nsyscalls = 0;
+    latency_histogram lat;
+    perf_counters* pc = counters ? new perf_counters : nullptr;
+    if (pc) {
+        pc->start();
+    }
+    double start = tstamp();
+
+    // `pos` walks through the file's chunks in the chosen order
+    off_t pos = 0, stride_start = 0;
+    if (strcmp(pattern, "rev") == 0) {
+        pos = size > 0 ? ((size - 1) / bufsize) * bufsize : -1;
     }
-    //printf("Opened fd %d\n", fd);
-   
-    while(1) {
-	char buffer[BUFFER_SIZE];        // Make a buffer to store part of file
-	memset(&buffer, 0, BUFFER_SIZE); // Sets it to zero
+    while (pos >= 0 && (size < 0 || pos < size)) {
+        const unsigned char* data = (const unsigned char*) buffer;
+        ssize_t bytes_read;
+        uint64_t t0 = cycles();
+        if (mf.data) {
+            data = &mf.data[pos];
+            bytes_read = std::min((off_t) bufsize, size - pos);
+        } else if (f) {
+            memset(buffer, 0, bufsize);      // Sets it to zero
+            io61_seek(f, pos);
+            bytes_read = io61_read(f, buffer, bufsize);
+        } else if (strcmp(pattern, "seq") == 0) {
+            memset(buffer, 0, bufsize);
+            bytes_read = read(fd, buffer, bufsize);
+            ++nsyscalls;
+        } else {
+            memset(buffer, 0, bufsize);
+            bytes_read = pread(fd, buffer, bufsize, pos);
+            ++nsyscalls;
+        }
+        lat.record(cycles() - t0);
+        if (bytes_read <= 0) {
+            break;
+        }
+        if (trace) {
+            fprintf(trace, "%lld %zd\n", (long long) pos, bytes_read);
+        }
+        for (ssize_t i = 0; i != bytes_read; ++i) {
+            checksum += data[i];
+        }
+        n += bytes_read;
 
-	int bytes_read = read(fd, buffer, BUFFER_SIZE);
-	// printf("read(%d, &buffer, %d) => %d, buffer: %s\n",
-	//        fd, BUFFER_SIZE, bytes_read, buffer);
- 
-	if (bytes_read <= 0) { 
-	    break;
-	}
+        if (strcmp(pattern, "seq") == 0) {
+            pos += bytes_read;
+        } else if (strcmp(pattern, "rev") == 0) {
+            pos -= bufsize;
+        } else if (pos + (off_t) stride < size) {
+            pos += stride;
+        } else {
+            stride_start += bufsize;
+            pos = stride_start < (off_t) stride ? stride_start : -1;
+        }
     }
 
+    if (pc) {
+        pc->stop();
+    }
+    report(n, tstamp() - start);
+    fprintf(stderr, "\nchecksum %lu\n", checksum);
+    report_latency(lat);
+    if (f) {
+        io61_print_stats(f, stderr);
+        io61_close(f);
+    } else if (use_mmap) {
+        long huge_kb = mf.data ? mapping_huge_kb(mf.data) : -1;
+        if (huge_kb >= 0) {
+            fprintf(stderr, "mmap: %ld kB in huge pages\n", huge_kb);
+        }
+        mmap_close(mf);
+        close(fd);
+    } else {
+        fprintf(stderr, "%zu syscalls   %g bytes/syscall\n",
+                nsyscalls, nsyscalls ? n / (double) nsyscalls : 0.0);
+        close(fd);
+    }
+    if (pc) {
+        pc->print(stderr, lat.n);
+        delete pc;
+    }
+    if (trace) {
+        fclose(trace);
+    }
+    free(buffer);
     return 0;
 }
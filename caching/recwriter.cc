@@ -0,0 +1,78 @@
+#include "recwriter.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+#include <unistd.h>
+
+record_writer::record_writer(int fd, record_method method, size_t max_records,
+                             size_t max_bytes, int pwritev2_flags)
+    : fd_(fd), method_(method),
+      max_records_(std::min(std::max(max_records, (size_t) 1), (size_t) IOV_MAX)),
+      max_bytes_(std::max(max_bytes, (size_t) 1)), flags_(pwritev2_flags) {
+    this->iov_.reserve(this->max_records_);
+}
+
+record_writer::~record_writer() {
+    this->flush();
+}
+
+void record_writer::append(const char* rec, size_t len) {
+    if (this->method_ == record_write) {
+        size_t done = 0;
+        while (done < len) {
+            ssize_t w = ::write(this->fd_, rec + done, len - done);
+            ++this->nsyscalls_;
+            if (w < 0 && errno != EINTR) {
+                perror("write");
+                exit(1);
+            } else if (w > 0) {
+                done += w;
+            }
+        }
+        return;
+    }
+    this->iov_.push_back({(void*) rec, len});
+    this->nbytes_ += len;
+    if (this->iov_.size() == this->max_records_
+        || this->nbytes_ >= this->max_bytes_) {
+        this->flush();
+    }
+}
+
+void record_writer::flush() {
+    if (this->iov_.empty()) {
+        return;
+    }
+    ++this->nbatches_;
+    struct iovec* iov = this->iov_.data();
+    int iovcnt = this->iov_.size();
+    while (iovcnt > 0) {
+        ssize_t w;
+        if (this->method_ == record_pwritev2) {
+            w = pwritev2(this->fd_, iov, iovcnt, -1, this->flags_);
+        } else {
+            w = writev(this->fd_, iov, iovcnt);
+        }
+        ++this->nsyscalls_;
+        if (w < 0 && errno == EINTR) {
+            continue;
+        } else if (w < 0) {
+            perror(this->method_ == record_pwritev2 ? "pwritev2" : "writev");
+            exit(1);
+        }
+        // skip fully-written records; adjust a partially-written one
+        while (iovcnt > 0 && (size_t) w >= iov->iov_len) {
+            w -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (w > 0) {
+            iov->iov_base = (char*) iov->iov_base + w;
+            iov->iov_len -= w;
+        }
+    }
+    this->iov_.clear();
+    this->nbytes_ = 0;
+}
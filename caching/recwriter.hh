@@ -0,0 +1,52 @@
+#ifndef RECWRITER_HH
+#define RECWRITER_HH
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+
+// record_writer
+//    Writes many small, variable-length records with as few system calls
+//    as possible by gathering them into an `iovec` batch.
+//
+//    `append()` does not copy: it records a pointer to the caller's record,
+//    which must stay valid until the next `flush()`. A batch is written
+//    with one `writev` (or `pwritev2`, which can also apply per-call flags
+//    such as RWF_DSYNC) once it holds `max_records` records or
+//    `max_bytes` bytes, whichever comes first.
+
+enum record_method {
+    record_write,               // one `write` per record (no batching)
+    record_writev,              // `writev` per batch
+    record_pwritev2             // `pwritev2(..., -1, flags)` per batch
+};
+
+struct record_writer {
+    record_writer(int fd, record_method method, size_t max_records,
+                  size_t max_bytes, int pwritev2_flags = 0);
+    ~record_writer();
+
+    // Append a record of `len` bytes at `rec`.
+    void append(const char* rec, size_t len);
+    // Write all pending records.
+    void flush();
+
+    size_t nsyscalls() const {
+        return this->nsyscalls_;
+    }
+    size_t nbatches() const {
+        return this->nbatches_;
+    }
+
+  private:
+    int fd_;
+    record_method method_;
+    size_t max_records_;
+    size_t max_bytes_;
+    int flags_;
+    std::vector<struct iovec> iov_;
+    size_t nbytes_ = 0;         // # bytes pending
+    size_t nsyscalls_ = 0;
+    size_t nbatches_ = 0;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "qslib.hh"
+#include "intsort.hh"
+#include "allowexec.hh"
+#include <string>
+
+// Usage: ./sortbench [-a ALGORITHM,...] [-t NTHREADS,...] [SIZE]
+//    Sort SIZE integers (default 10000000) with each algorithm (default
+//    all: std, intro, pquick, pmerge, radix) for each initialization
+//    pattern (random, sequential, reverse sequential, magic, and zipf, which
+//    has many duplicates) and each thread count (default 1,2,4,8; the
+//    sequential algorithms run once). Every result is checked with
+//    `ints_checksum` and `ints_sorted`.
+
+struct sort_algorithm {
+    const char* name;
+    bool parallel;
+    void (*sort)(int* array, int n, int nthreads);
+};
+
+static const sort_algorithm algorithms[] = {
+    {"std", false, [] (int* a, int n, int) { std::sort(a, a + n); }},
+    {"intro", false, [] (int* a, int n, int) { ints_introsort(a, n); }},
+    {"pquick", true, ints_parallel_quicksort},
+    {"pmerge", true, ints_parallel_mergesort},
+    {"radix", false, [] (int* a, int n, int) { ints_radixsort(a, n); }}
+};
+
+struct sort_pattern {
+    const char* name;
+    void (*initialize)(int* array, int n);
+};
+
+static const sort_pattern patterns[] = {
+    {"random", initialize_random},
+    {"sequential", initialize_up},
+    {"reverse", initialize_down},
+    {"magic", initialize_magic},
+    {"zipf", [] (int* a, int n) { initialize_zipf(a, n, 0.99); }}
+};
+
+static std::vector<std::string> split(const char* arg) {
+    std::vector<std::string> v;
+    std::string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t comma = std::min(s.find(',', pos), s.size());
+        v.push_back(s.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    return v;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s [-a ALGORITHM,...] [-t NTHREADS,...] [SIZE]\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    int n = 10000000;
+    std::vector<const sort_algorithm*> chosen;
+    std::vector<int> thread_counts = {1, 2, 4, 8};
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            for (auto& name : split(argv[i + 1])) {
+                auto it = std::find_if(std::begin(algorithms), std::end(algorithms),
+                    [&] (const sort_algorithm& a) { return name == a.name; });
+                if (it == std::end(algorithms)) {
+                    fprintf(stderr, "%s: unknown algorithm `%s`\n", argv[0], name.c_str());
+                    exit(1);
+                }
+                chosen.push_back(it);
+            }
+            ++i;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            thread_counts.clear();
+            for (auto& t : split(argv[i + 1])) {
+                if (!strisnumber(t.c_str()) || atoi(t.c_str()) <= 0) {
+                    usage(argv[0]);
+                }
+                thread_counts.push_back(atoi(t.c_str()));
+            }
+            ++i;
+        } else if (strisnumber(argv[i]) && strtol(argv[i], NULL, 0) > 0) {
+            n = strtol(argv[i], NULL, 0);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (chosen.empty()) {
+        for (auto& a : algorithms) {
+            chosen.push_back(&a);
+        }
+    }
+
+    int* init = new int[n];
+    int* array = new int[n];
+    printf("%-8s %-10s %8s %10s %12s\n",
+           "algo", "pattern", "threads", "seconds", "Mints/sec");
+    for (auto& p : patterns) {
+        p.initialize(init, n);
+        unsigned checksum = ints_checksum(init, n);
+        for (auto a : chosen) {
+            for (int nthreads : thread_counts) {
+                memcpy(array, init, sizeof(int) * n);
+                double start = tstamp();
+                a->sort(array, n, nthreads);
+                double elapsed = tstamp() - start;
+                if (ints_checksum(array, n) != checksum
+                    || !ints_sorted(array, n)) {
+                    fprintf(stderr, "%s: %s failed on %s input with %d threads\n",
+                            argv[0], a->name, p.name, nthreads);
+                    exit(1);
+                }
+                printf("%-8s %-10s %8d %10.4f %12.2f\n", a->name, p.name,
+                       a->parallel ? nthreads : 1, elapsed, n / elapsed / 1e6);
+                fflush(stdout);
+                if (!a->parallel) {
+                    break;
+                }
+            }
+        }
+    }
+    delete[] init;
+    delete[] array;
+}
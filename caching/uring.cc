@@ -0,0 +1,295 @@
+#include "uring.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int ring_fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                   flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(int ring_fd, unsigned opcode,
+                                 const void* arg, unsigned nr_args) {
+    return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+
+uring_writer::uring_writer(int fd, size_t block_size, unsigned depth)
+    : fd_(fd), block_size_(block_size), depth_(depth) {
+    if (block_size == 0 || depth == 0) {
+        fprintf(stderr, "uring_writer: block size and depth must be positive\n");
+        exit(1);
+    }
+    this->off_ = lseek(fd, 0, SEEK_CUR);
+    this->seekable_ = this->off_ >= 0;
+    if (!this->seekable_) {
+        this->depth_ = 1;
+    }
+
+    // page-aligned buffers
+    void* p = mmap(nullptr, this->depth_ * block_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    this->buf_ = (char*) p;
+    this->reqs_.resize(this->depth_);
+    for (unsigned i = this->depth_; i != 0; --i) {
+        this->free_.push_back(i - 1);
+    }
+
+    if (!this->setup_ring()) {
+        this->ring_fd_ = -1;
+    }
+}
+
+uring_writer::~uring_writer() {
+    this->flush();
+    if (this->ring_fd_ >= 0) {
+        munmap(this->sqes_, this->sqes_size_);
+        if (this->cq_ring_ != this->sq_ring_) {
+            munmap(this->cq_ring_, this->cq_ring_size_);
+        }
+        munmap(this->sq_ring_, this->sq_ring_size_);
+        close(this->ring_fd_);
+    }
+    munmap(this->buf_, this->depth_ * this->block_size_);
+}
+
+const char* uring_writer::method() const {
+    if (this->ring_fd_ < 0) {
+        return "pwrite (io_uring unavailable)";
+    } else if (!this->fixed_) {
+        return "io_uring";
+    } else {
+        return "io_uring, registered buffers";
+    }
+}
+
+// Create the ring and map its submission and completion queues.
+bool uring_writer::setup_ring() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    this->ring_fd_ = sys_io_uring_setup(this->depth_, &params);
+    if (this->ring_fd_ < 0) {
+        return false;
+    }
+
+    this->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        this->sq_ring_size_ = this->cq_ring_size_ =
+            std::max(this->sq_ring_size_, this->cq_ring_size_);
+    }
+    this->sq_ring_ = mmap(nullptr, this->sq_ring_size_,
+                          PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          this->ring_fd_, IORING_OFF_SQ_RING);
+    if (this->sq_ring_ == MAP_FAILED) {
+        close(this->ring_fd_);
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        this->cq_ring_ = this->sq_ring_;
+    } else {
+        this->cq_ring_ = mmap(nullptr, this->cq_ring_size_,
+                              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              this->ring_fd_, IORING_OFF_CQ_RING);
+        if (this->cq_ring_ == MAP_FAILED) {
+            munmap(this->sq_ring_, this->sq_ring_size_);
+            close(this->ring_fd_);
+            return false;
+        }
+    }
+    this->sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, this->sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, this->ring_fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (this->cq_ring_ != this->sq_ring_) {
+            munmap(this->cq_ring_, this->cq_ring_size_);
+        }
+        munmap(this->sq_ring_, this->sq_ring_size_);
+        close(this->ring_fd_);
+        return false;
+    }
+    this->sqes_ = (struct io_uring_sqe*) sqes;
+
+    char* sq = (char*) this->sq_ring_;
+    this->sq_head_ = (unsigned*) (sq + params.sq_off.head);
+    this->sq_tail_ = (unsigned*) (sq + params.sq_off.tail);
+    this->sq_mask_ = (unsigned*) (sq + params.sq_off.ring_mask);
+    this->sq_array_ = (unsigned*) (sq + params.sq_off.array);
+    char* cq = (char*) this->cq_ring_;
+    this->cq_head_ = (unsigned*) (cq + params.cq_off.head);
+    this->cq_tail_ = (unsigned*) (cq + params.cq_off.tail);
+    this->cq_mask_ = (unsigned*) (cq + params.cq_off.ring_mask);
+    this->cqes_ = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+    // register buffers so the kernel needn't map them on every request
+    std::vector<struct iovec> iov(this->depth_);
+    for (unsigned i = 0; i != this->depth_; ++i) {
+        iov[i].iov_base = &this->buf_[i * this->block_size_];
+        iov[i].iov_len = this->block_size_;
+    }
+    this->fixed_ = sys_io_uring_register(this->ring_fd_,
+                                         IORING_REGISTER_BUFFERS,
+                                         iov.data(), this->depth_) == 0;
+    return true;
+}
+
+ssize_t uring_writer::write(const char* buf, size_t sz) {
+    size_t pos = 0;
+    while (pos < sz) {
+        if (this->cur_ < 0) {
+            this->cur_ = this->get_free();
+            this->pos_ = 0;
+        }
+        size_t n = std::min(sz - pos, this->block_size_ - this->pos_);
+        memcpy(&this->buf_[this->cur_ * this->block_size_ + this->pos_],
+               &buf[pos], n);
+        this->pos_ += n;
+        pos += n;
+        if (this->pos_ == this->block_size_) {
+            this->queue(this->cur_);
+            this->cur_ = -1;
+        }
+    }
+    return sz;
+}
+
+void uring_writer::flush() {
+    if (this->cur_ >= 0 && this->pos_ > 0) {
+        this->queue(this->cur_);
+        this->cur_ = -1;
+    }
+    while (this->ring_fd_ >= 0 && (this->inflight_ > 0 || this->to_submit_ > 0)) {
+        this->enter(this->inflight_ > 0 ? 1 : 0);
+        this->reap();
+    }
+}
+
+// Start writing buffer `i`. The first request for a buffer covers
+// `pos_` bytes; later requests cover whatever a short write left.
+void uring_writer::queue(unsigned i) {
+    request& r = this->reqs_[i];
+    if ((int) i == this->cur_) {
+        r.len = this->pos_;
+        r.done = 0;
+        r.off = this->off_;
+        if (this->seekable_) {
+            this->off_ += this->pos_;
+        }
+        ++this->inflight_;
+    }
+
+    if (this->ring_fd_ < 0) {
+        // synchronous fallback
+        while (r.done < r.len) {
+            const char* p = &this->buf_[i * this->block_size_ + r.done];
+            ssize_t w = this->seekable_
+                ? pwrite(this->fd_, p, r.len - r.done, r.off + r.done)
+                : ::write(this->fd_, p, r.len - r.done);
+            ++this->nsyscalls_;
+            if (w < 0 && errno != EINTR && errno != EAGAIN) {
+                perror("write");
+                exit(1);
+            } else if (w > 0) {
+                r.done += w;
+            }
+        }
+        this->nwritten_ += r.len;
+        --this->inflight_;
+        this->free_.push_back(i);
+        return;
+    }
+
+    unsigned tail = *this->sq_tail_;
+    unsigned idx = tail & *this->sq_mask_;
+    struct io_uring_sqe* sqe = &this->sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = this->fixed_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = this->fd_;
+    sqe->addr = (uintptr_t) &this->buf_[i * this->block_size_ + r.done];
+    sqe->len = r.len - r.done;
+    sqe->off = this->seekable_ ? r.off + r.done : (__u64) -1;
+    sqe->buf_index = i;
+    sqe->user_data = i;
+    this->sq_array_[idx] = idx;
+    __atomic_store_n(this->sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++this->to_submit_;
+    if (this->free_.empty()) {
+        return;                 // `get_free()` will submit with its wait
+    }
+    this->enter(0);
+}
+
+// Submit queued requests and wait for at least `min_complete` completions.
+void uring_writer::enter(unsigned min_complete) {
+    int r;
+    do {
+        r = sys_io_uring_enter(this->ring_fd_, this->to_submit_, min_complete,
+                               min_complete ? IORING_ENTER_GETEVENTS : 0);
+        ++this->nsyscalls_;
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) {
+        perror("io_uring_enter");
+        exit(1);
+    }
+    this->to_submit_ -= r;
+}
+
+// Process completions. Short writes are resubmitted; finished buffers
+// are returned to the free list.
+void uring_writer::reap() {
+    unsigned head = *this->cq_head_;
+    while (head != __atomic_load_n(this->cq_tail_, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe* cqe = &this->cqes_[head & *this->cq_mask_];
+        unsigned i = cqe->user_data;
+        int res = cqe->res;
+        ++head;
+        __atomic_store_n(this->cq_head_, head, __ATOMIC_RELEASE);
+
+        request& r = this->reqs_[i];
+        if (res < 0 && res != -EINTR && res != -EAGAIN) {
+            fprintf(stderr, "io_uring write: %s\n", strerror(-res));
+            exit(1);
+        } else if (res > 0) {
+            r.done += res;
+        }
+        if (r.done < r.len) {
+            this->queue(i);
+        } else {
+            this->nwritten_ += r.len;
+            --this->inflight_;
+            this->free_.push_back(i);
+        }
+    }
+}
+
+// Return a free buffer, waiting for a write to complete if necessary.
+unsigned uring_writer::get_free() {
+    if (this->ring_fd_ >= 0) {
+        this->reap();
+        while (this->free_.empty()) {
+            this->enter(1);
+            this->reap();
+        }
+    }
+    unsigned i = this->free_.back();
+    this->free_.pop_back();
+    return i;
+}
@@ -0,0 +1,96 @@
+#ifndef URING_HH
+#define URING_HH
+#include <sys/types.h>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// uring_writer
+//    An asynchronous writer that keeps up to `depth` block writes in flight
+//    using io_uring.
+//
+//    `write()` copies data into one of `depth` buffers of `block_size`
+//    bytes. A full buffer is submitted as an IORING_OP_WRITE_FIXED request
+//    (the buffers are registered with the kernel up front) and the writer
+//    moves on to a free buffer, waiting for a completion only when all
+//    buffers are in flight.
+//
+//    The ring is driven with raw `io_uring_setup`/`io_uring_enter` system
+//    calls, so liburing is not required. If io_uring is unavailable (old
+//    kernel, seccomp, `kernel.io_uring_disabled`), the writer falls back to
+//    synchronous `pwrite`; if buffer registration fails (RLIMIT_MEMLOCK), it
+//    uses unregistered IORING_OP_WRITE requests.
+//
+//    Writes to unseekable files (pipes) could complete out of order, so
+//    they are limited to one write in flight.
+
+struct uring_writer {
+    uring_writer(int fd, size_t block_size, unsigned depth);
+    ~uring_writer();
+
+    // Write `sz` bytes from `buf`. Returns `sz`.
+    ssize_t write(const char* buf, size_t sz);
+    // Submit any buffered data and wait for all writes to complete.
+    void flush();
+
+    // Return a description of the I/O method actually used.
+    const char* method() const;
+    unsigned depth() const {
+        return this->depth_;
+    }
+    size_t nsyscalls() const {
+        return this->nsyscalls_;
+    }
+    size_t nwritten() const {
+        return this->nwritten_;
+    }
+
+  private:
+    struct request {
+        size_t len = 0;         // # bytes in buffer
+        size_t done = 0;        // # bytes written so far
+        off_t off = 0;          // file offset of buffer
+    };
+
+    int fd_;
+    size_t block_size_;
+    unsigned depth_;
+    bool seekable_;
+    off_t off_;                 // file offset of next buffer
+    char* buf_;                 // `depth_ * block_size_` bytes
+    std::vector<request> reqs_;
+    std::vector<unsigned> free_;
+    int cur_ = -1;              // buffer being filled, or -1
+    size_t pos_ = 0;            // # bytes in current buffer
+
+    int ring_fd_ = -1;
+    bool fixed_ = false;        // buffers registered
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    io_uring_cqe* cqes_;
+    unsigned to_submit_ = 0;    // # queued but unsubmitted requests
+    unsigned inflight_ = 0;     // # buffers submitted and not complete
+
+    size_t nsyscalls_ = 0;
+    size_t nwritten_ = 0;
+
+    bool setup_ring();
+    void queue(unsigned i);
+    void enter(unsigned min_complete);
+    void reap();
+    unsigned get_free();
+};
+
+#endif
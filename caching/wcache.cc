@@ -0,0 +1,165 @@
+#include "wcache.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/uio.h>
+
+wcache::wcache(int fd, size_t block_size, size_t nslots, size_t threshold,
+               bool write_behind)
+    : fd_(fd), block_size_(block_size), nslots_(nslots),
+      threshold_(std::min(std::max(threshold, (size_t) 1), nslots)),
+      write_behind_(write_behind) {
+    if (block_size == 0 || nslots == 0) {
+        fprintf(stderr, "wcache: block size and slot count must be positive\n");
+        exit(1);
+    }
+    this->buf_ = (char*) malloc(nslots * block_size);
+    this->len_ = new size_t[nslots];
+    this->iov_ = new struct iovec[nslots];
+    if (!this->buf_) {
+        perror("malloc");
+        exit(1);
+    }
+    if (write_behind) {
+        this->flusher_ = std::thread(&wcache::flusher_loop, this);
+    }
+}
+
+wcache::~wcache() {
+    this->flush();
+    if (this->write_behind_) {
+        {
+            std::unique_lock<std::mutex> guard(this->mutex_);
+            this->closing_ = true;
+            this->dirty_.notify_all();
+        }
+        this->flusher_.join();
+    }
+    free(this->buf_);
+    delete[] this->len_;
+    delete[] this->iov_;
+}
+
+ssize_t wcache::write(const char* buf, size_t sz) {
+    size_t pos = 0;
+    while (pos < sz) {
+        size_t n = std::min(sz - pos, this->block_size_ - this->pos_);
+        memcpy(&this->buf_[this->cur_ * this->block_size_ + this->pos_],
+               &buf[pos], n);
+        this->pos_ += n;
+        pos += n;
+        if (this->pos_ == this->block_size_) {
+            this->mark_dirty();
+        }
+    }
+    return sz;
+}
+
+void wcache::flush() {
+    if (this->pos_ > 0) {
+        this->mark_dirty();
+    }
+    if (!this->write_behind_) {
+        if (this->ndirty_ > 0) {
+            this->write_slots(this->head_, this->ndirty_);
+            this->head_ = (this->head_ + this->ndirty_) % this->nslots_;
+            this->ndirty_ = 0;
+        }
+    } else {
+        std::unique_lock<std::mutex> guard(this->mutex_);
+        this->flush_requested_ = true;
+        this->dirty_.notify_all();
+        while (this->flush_requested_ || this->ndirty_ > 0) {
+            this->clean_.wait(guard);
+        }
+    }
+}
+
+// Mark the current slot dirty and advance to the next slot, flushing
+// (synchronously) or waiting for the flusher (write-behind) as required.
+void wcache::mark_dirty() {
+    this->len_[this->cur_] = this->pos_;
+    if (!this->write_behind_) {
+        ++this->ndirty_;
+        if (this->ndirty_ >= this->threshold_) {
+            this->write_slots(this->head_, this->ndirty_);
+            this->head_ = (this->head_ + this->ndirty_) % this->nslots_;
+            this->ndirty_ = 0;
+        }
+    } else {
+        std::unique_lock<std::mutex> guard(this->mutex_);
+        ++this->ndirty_;
+        if (this->ndirty_ >= this->threshold_) {
+            this->dirty_.notify_all();
+        }
+        while (this->ndirty_ == this->nslots_) {
+            this->clean_.wait(guard);
+        }
+    }
+    this->cur_ = (this->cur_ + 1) % this->nslots_;
+    this->pos_ = 0;
+}
+
+// Write `n` slots, starting at slot `first`, with as few `writev` calls
+// as possible.
+void wcache::write_slots(size_t first, size_t n) {
+    for (size_t i = 0; i != n; ++i) {
+        size_t slot = (first + i) % this->nslots_;
+        this->iov_[i].iov_base = &this->buf_[slot * this->block_size_];
+        this->iov_[i].iov_len = this->len_[slot];
+    }
+    size_t i = 0;
+    while (i != n) {
+        int iovcnt = std::min(n - i, (size_t) IOV_MAX);
+        ssize_t w = writev(this->fd_, &this->iov_[i], iovcnt);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        } else if (w < 0) {
+            perror("writev");
+            exit(1);
+        }
+        ++this->nsyscalls_;
+        this->nflushed_ += w;
+        // skip fully-written slots; adjust a partially-written one
+        while (i != n && (size_t) w >= this->iov_[i].iov_len) {
+            w -= this->iov_[i].iov_len;
+            ++i;
+        }
+        if (w > 0) {
+            this->iov_[i].iov_base = (char*) this->iov_[i].iov_base + w;
+            this->iov_[i].iov_len -= w;
+        }
+    }
+}
+
+void wcache::flusher_loop() {
+    std::unique_lock<std::mutex> guard(this->mutex_);
+    while (true) {
+        while (this->ndirty_ < this->threshold_
+               && !this->flush_requested_
+               && !this->closing_) {
+            this->dirty_.wait(guard);
+        }
+        if (this->ndirty_ > 0) {
+            // The writer only touches slots outside [head_, head_ + ndirty_),
+            // so the dirty slots can be written without holding the lock.
+            size_t first = this->head_, n = this->ndirty_;
+            guard.unlock();
+            this->write_slots(first, n);
+            guard.lock();
+            this->head_ = (this->head_ + n) % this->nslots_;
+            this->ndirty_ -= n;
+            this->clean_.notify_all();
+            continue;
+        }
+        this->flush_requested_ = false;
+        this->clean_.notify_all();
+        if (this->closing_) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef WCACHE_HH
+#define WCACHE_HH
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// wcache
+//    A userspace write cache in front of a file descriptor.
+//
+//    The cache is a ring of `nslots` slots of `block_size` bytes each.
+//    `write()` copies bytes into the current slot. When the slot fills, it
+//    becomes dirty and the writer moves on to the next slot. Dirty slots
+//    are written to the file, oldest first, according to the flush policy:
+//
+//    - `threshold == 1` (flush-on-full): flush each slot as soon as it
+//      fills.
+//    - `threshold > 1` (flush-on-threshold): let up to `threshold` slots
+//      accumulate, then flush them all with a single `writev`.
+//
+//    If `write_behind` is true, flushing happens on a background thread,
+//    so the writer can keep filling free slots while earlier slots are
+//    being written. The writer only blocks when every slot is dirty.
+//
+//    A single-slot cache is `nslots == 1, threshold == 1`.
+
+struct wcache {
+    wcache(int fd, size_t block_size, size_t nslots, size_t threshold,
+           bool write_behind);
+    ~wcache();
+
+    // Write `sz` bytes from `buf`. Returns `sz`.
+    ssize_t write(const char* buf, size_t sz);
+    // Write all cached data, including a partially-full slot, to the file.
+    void flush();
+
+    size_t nsyscalls() const {
+        return this->nsyscalls_;
+    }
+    size_t nflushed() const {
+        return this->nflushed_;
+    }
+
+  private:
+    int fd_;
+    size_t block_size_;
+    size_t nslots_;
+    size_t threshold_;
+    char* buf_;               // `nslots_ * block_size_` bytes
+    size_t* len_;             // # bytes in each slot
+    size_t head_ = 0;         // index of oldest dirty slot
+    size_t ndirty_ = 0;       // # dirty slots, starting at `head_`
+    size_t cur_ = 0;          // index of slot being filled
+    size_t pos_ = 0;          // # bytes in current slot
+    struct iovec* iov_;       // scratch space for `writev`
+
+    size_t nsyscalls_ = 0;
+    size_t nflushed_ = 0;     // # bytes written to the file
+
+    bool write_behind_;
+    bool flush_requested_ = false;
+    bool closing_ = false;
+    std::thread flusher_;
+    std::mutex mutex_;
+    std::condition_variable dirty_;
+    std::condition_variable clean_;
+
+    void mark_dirty();
+    void write_slots(size_t first, size_t n);
+    void flusher_loop();
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef HRTIME_HH
+#define HRTIME_HH
+#include <cstdint>
+#include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+// High-resolution timing shared by the benchmarks.
+//
+//    `tstamp()` returns seconds on CLOCK_MONOTONIC_RAW, which has nanosecond
+//    resolution, is read through the vDSO without a system call, and (unlike
+//    CLOCK_REALTIME or `gettimeofday`) never jumps when NTP or an
+//    administrator adjusts the wall clock. Use it for whole-run timings.
+//
+//    `cycles()` is cheaper still, for timing individual operations. On x86
+//    CPUs with an invariant TSC (constant rate across frequency changes and
+//    idle states) it reads the time-stamp counter; elsewhere it returns
+//    CLOCK_MONOTONIC_RAW nanoseconds. `cycles_per_sec()` calibrates its
+//    rate against CLOCK_MONOTONIC_RAW.
+//
+//    Reading a clock is not free, and for sub-microsecond regions the cost
+//    of the reads matters. `cycles_overhead()` and `tstamp_overhead()`
+//    measure the minimum cost of two back-to-back reads, and
+//    `cycles_since()` subtracts it, so an empty region times as 0.
+
+
+// tstamp()
+//    Return the current time as a double, in seconds since an arbitrary
+//    epoch (usually boot).
+
+inline double tstamp() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+
+// tsc_invariant()
+//    Return true if the CPU advertises an invariant time-stamp counter
+//    (CPUID leaf 0x80000007, EDX bit 8).
+
+inline bool tsc_invariant() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    return __get_cpuid(0x80000007, &a, &b, &c, &d) && (d & (1U << 8));
+#else
+    return false;
+#endif
+}
+
+inline const bool cycles_use_tsc = tsc_invariant();
+
+
+// cycles()
+//    Return a timestamp for timing individual operations, in units of
+//    `1 / cycles_per_sec()` seconds.
+
+inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (cycles_use_tsc) {
+        return __rdtsc();
+    }
+#endif
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Return a description of the clock behind `cycles()`.
+inline const char* cycles_source() {
+    return cycles_use_tsc ? "invariant TSC" : "CLOCK_MONOTONIC_RAW";
+}
+
+
+// cycles_per_sec()
+//    Return the rate of `cycles()`. The TSC rate is calibrated once, over
+//    about 20 ms, against CLOCK_MONOTONIC_RAW; each end of the interval is
+//    read with the TSC bracketing the clock read, so the error is a few
+//    parts per million.
+
+inline double cycles_per_sec() {
+    static double rate = 0;
+    if (rate == 0 && !cycles_use_tsc) {
+        rate = 1e9;
+    } else if (rate == 0) {
+        uint64_t c0a = cycles();
+        double t0 = tstamp();
+        uint64_t c0b = cycles();
+        double t1;
+        while ((t1 = tstamp()) - t0 < 0.02) {
+        }
+        uint64_t c1a = cycles();
+        t1 = tstamp();
+        uint64_t c1b = cycles();
+        rate = ((c1a + c1b) / 2.0 - (c0a + c0b) / 2.0) / (t1 - t0);
+    }
+    return rate;
+}
+
+
+// cycles_overhead()
+//    Return the minimum number of `cycles()` units between two back-to-back
+//    `cycles()` calls: the cost a timed region includes even when empty.
+
+inline uint64_t cycles_overhead() {
+    static uint64_t overhead = UINT64_MAX;
+    if (overhead == UINT64_MAX) {
+        for (int i = 0; i != 1000; ++i) {
+            uint64_t c0 = cycles();
+            uint64_t c1 = cycles();
+            if (c1 - c0 < overhead) {
+                overhead = c1 - c0;
+            }
+        }
+    }
+    return overhead;
+}
+
+// cycles_since(c0)
+//    Return the `cycles()` units elapsed since `c0 = cycles()`, minus the
+//    timer overhead (never less than 0).
+
+inline uint64_t cycles_since(uint64_t c0) {
+    uint64_t c1 = cycles();
+    uint64_t overhead = cycles_overhead();
+    return c1 - c0 > overhead ? c1 - c0 - overhead : 0;
+}
+
+
+// tstamp_overhead()
+//    Return the minimum time, in seconds, between two back-to-back
+//    `tstamp()` calls.
+
+inline double tstamp_overhead() {
+    static double overhead = -1;
+    if (overhead < 0) {
+        overhead = 1;
+        for (int i = 0; i != 1000; ++i) {
+            double t0 = tstamp();
+            double t1 = tstamp();
+            if (t1 - t0 < overhead) {
+                overhead = t1 - t0;
+            }
+        }
+    }
+    return overhead;
+}
+
+#endif
@@ -13,15 +13,7 @@
 #include <sys/select.h>
 #include <sched.h>
 #include <errno.h>
-
-// tstamp()
-//    Return the current time as a double.
-
-inline double tstamp() {
-    struct timespec tv;
-    clock_gettime(CLOCK_REALTIME, &tv);
-    return tv.tv_sec + tv.tv_nsec * 1.0e-9;
-}
+#include "../common/hrtime.hh"
 
 
 // nfork()